@@ -1,10 +1,18 @@
 """
 Run heuristic queries against the Niya solver database and display formatted results.
 
+The queries read the rollup tables solution_counts and p2_counts, which the
+solver keeps up to date on every insert (see src/database.py): one row per
+combination of the grouped columns with its row count n, so every query
+takes milliseconds however many boards are solved. --raw answers the same
+queries from the raw rows instead, through temporary views with the same
+names (used automatically for databases that predate the rollups).
+
 Usage:
     python analyze.py              # Run all queries
     python analyze.py --query 3    # Run a specific query by number
     python analyze.py --list       # List available queries
+    python analyze.py --raw        # Scan the raw tables (cross-checks the rollups)
 """
 
 import sqlite3
@@ -12,23 +20,36 @@ import argparse
 import sys
 import os
 
-DB_PATH = os.path.join(os.path.dirname(__file__), "data", "niya.db")
+DB_PATH = os.path.join(
+    os.environ.get("NIYA_DATA_DIR") or os.path.join(os.path.dirname(__file__), "data"), "niya.db"
+)
+
+# The rollup tables as views over the raw rows, each row counting once
+RAW_VIEWS = """
+CREATE TEMP VIEW solution_counts AS
+    SELECT p1_win, is_draw, p1_best_move, p1_outcome, p1_best_move_pos, game_depth,
+           p1_wins_count, p2_wins_count, draws_count, has_p2_data, 1 AS n
+    FROM solutions;
+CREATE TEMP VIEW p2_counts AS
+    SELECT s.p1_win AS board_p1_win, r.p1_move, r.p2_best_move, r.is_p1_win, r.outcome, 1 AS n
+    FROM p2_responses r LEFT JOIN solutions s ON s.perm_index = r.perm_index;
+"""
 
-# Each query: (title, description, sql)
+# Each query: (title, description, sql); COUNT(*) over boards is SUM(n)
 QUERIES: list[tuple[str, str, str]] = [
     (
         "Game Balance",
         "Overall P1 win % vs P2 win % vs draw %",
         """
         SELECT
-            SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) AS p1_wins,
-            SUM(CASE WHEN is_draw = 1 THEN 1 ELSE 0 END) AS draws,
-            SUM(CASE WHEN p1_win = 0 AND is_draw = 0 THEN 1 ELSE 0 END) AS p2_wins,
-            COUNT(*) AS total,
-            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) / COUNT(*), 2) AS p1_win_pct,
-            ROUND(100.0 * SUM(CASE WHEN is_draw = 1 THEN 1 ELSE 0 END) / COUNT(*), 2) AS draw_pct,
-            ROUND(100.0 * SUM(CASE WHEN p1_win = 0 AND is_draw = 0 THEN 1 ELSE 0 END) / COUNT(*), 2) AS p2_win_pct
-        FROM solutions
+            SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) AS p1_wins,
+            SUM(CASE WHEN is_draw = 1 THEN n ELSE 0 END) AS draws,
+            SUM(CASE WHEN p1_win = 0 AND is_draw = 0 THEN n ELSE 0 END) AS p2_wins,
+            SUM(n) AS total,
+            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) / SUM(n), 2) AS p1_win_pct,
+            ROUND(100.0 * SUM(CASE WHEN is_draw = 1 THEN n ELSE 0 END) / SUM(n), 2) AS draw_pct,
+            ROUND(100.0 * SUM(CASE WHEN p1_win = 0 AND is_draw = 0 THEN n ELSE 0 END) / SUM(n), 2) AS p2_win_pct
+        FROM solution_counts
         """,
     ),
     (
@@ -49,14 +70,15 @@ QUERIES: list[tuple[str, str, str]] = [
                     WHEN p1_wins_count = 0 AND draws_count = 0 THEN 'P2 dominates all openings'
                     WHEN draws_count = p1_wins_count + p2_wins_count + draws_count THEN 'All draws'
                     ELSE 'Mixed (contested)'
-                END AS board_type
-            FROM solutions
+                END AS board_type,
+                n
+            FROM solution_counts
             WHERE has_p2_data = 1
         )
         SELECT
             c.board_type,
-            COUNT(cl.board_type) AS count,
-            ROUND(100.0 * COUNT(cl.board_type) / MAX((SELECT COUNT(*) FROM classified), 1), 2) AS pct
+            COALESCE(SUM(cl.n), 0) AS count,
+            ROUND(100.0 * COALESCE(SUM(cl.n), 0) / MAX((SELECT SUM(n) FROM classified), 1), 2) AS pct
         FROM categories c
         LEFT JOIN classified cl ON cl.board_type = c.board_type
         GROUP BY c.board_type, c.sort_order
@@ -70,10 +92,10 @@ QUERIES: list[tuple[str, str, str]] = [
         SELECT
             p1_best_move AS move,
             p1_best_move_pos AS position,
-            COUNT(*) AS times_chosen,
-            SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) AS wins,
-            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) / COUNT(*), 2) AS win_pct
-        FROM solutions
+            SUM(n) AS times_chosen,
+            SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) AS wins,
+            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) / SUM(n), 2) AS win_pct
+        FROM solution_counts
         WHERE p1_best_move >= 0
         GROUP BY p1_best_move
         ORDER BY win_pct DESC
@@ -85,10 +107,10 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             p1_best_move_pos AS position_type,
-            COUNT(*) AS total,
-            SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) AS wins,
-            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN 1 ELSE 0 END) / COUNT(*), 2) AS win_pct
-        FROM solutions
+            SUM(n) AS total,
+            SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) AS wins,
+            ROUND(100.0 * SUM(CASE WHEN p1_win = 1 THEN n ELSE 0 END) / SUM(n), 2) AS win_pct
+        FROM solution_counts
         WHERE p1_best_move >= 0
         GROUP BY p1_best_move_pos
         """,
@@ -99,9 +121,9 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             p1_outcome AS outcome,
-            COUNT(*) AS frequency,
-            ROUND(100.0 * COUNT(*) / (SELECT COUNT(*) FROM solutions), 2) AS pct
-        FROM solutions
+            SUM(n) AS frequency,
+            ROUND(100.0 * SUM(n) / (SELECT SUM(n) FROM solution_counts), 2) AS pct
+        FROM solution_counts
         GROUP BY p1_outcome
         ORDER BY frequency DESC
         """,
@@ -112,9 +134,9 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             game_depth AS depth,
-            COUNT(*) AS frequency,
-            ROUND(100.0 * COUNT(*) / (SELECT COUNT(*) FROM solutions), 2) AS pct
-        FROM solutions
+            SUM(n) AS frequency,
+            ROUND(100.0 * SUM(n) / (SELECT SUM(n) FROM solution_counts), 2) AS pct
+        FROM solution_counts
         GROUP BY game_depth
         ORDER BY game_depth
         """,
@@ -125,11 +147,11 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             p1_outcome AS outcome,
-            ROUND(AVG(game_depth), 1) AS avg_depth,
+            ROUND(1.0 * SUM(game_depth * n) / SUM(n), 1) AS avg_depth,
             MIN(game_depth) AS shortest,
             MAX(game_depth) AS longest,
-            COUNT(*) AS count
-        FROM solutions
+            SUM(n) AS count
+        FROM solution_counts
         GROUP BY p1_outcome
         ORDER BY avg_depth
         """,
@@ -139,14 +161,13 @@ QUERIES: list[tuple[str, str, str]] = [
         "Top P2 responses that flip P1-favored boards (P1 wins overall, but P2 wins specific openings)",
         """
         SELECT
-            r.p1_move,
-            r.p2_best_move,
-            r.outcome,
-            COUNT(*) AS frequency
-        FROM p2_responses r
-        JOIN solutions s ON s.perm_index = r.perm_index
-        WHERE s.p1_win = 1 AND r.is_p1_win = 0 AND r.outcome != 'Draw'
-        GROUP BY r.p1_move, r.p2_best_move, r.outcome
+            p1_move,
+            p2_best_move,
+            outcome,
+            SUM(n) AS frequency
+        FROM p2_counts
+        WHERE board_p1_win = 1 AND is_p1_win = 0 AND outcome != 'Draw'
+        GROUP BY p1_move, p2_best_move, outcome
         ORDER BY frequency DESC
         LIMIT 20
         """,
@@ -157,9 +178,9 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             outcome,
-            COUNT(*) AS frequency,
-            ROUND(100.0 * COUNT(*) / (SELECT COUNT(*) FROM p2_responses), 2) AS pct
-        FROM p2_responses
+            SUM(n) AS frequency,
+            ROUND(100.0 * SUM(n) / (SELECT SUM(n) FROM p2_counts), 2) AS pct
+        FROM p2_counts
         GROUP BY outcome
         ORDER BY frequency DESC
         """,
@@ -182,14 +203,15 @@ QUERIES: list[tuple[str, str, str]] = [
                     WHEN p2_wins_count = p1_wins_count + p2_wins_count + draws_count THEN 'P2 wins all'
                     WHEN draws_count = p1_wins_count + p2_wins_count + draws_count THEN 'All draws'
                     ELSE 'Contested'
-                END AS board_class
-            FROM solutions
+                END AS board_class,
+                n
+            FROM solution_counts
             WHERE has_p2_data = 1
         )
         SELECT
             c.board_class,
-            COUNT(cl.board_class) AS count,
-            ROUND(100.0 * COUNT(cl.board_class) / MAX((SELECT COUNT(*) FROM classified), 1), 2) AS pct
+            COALESCE(SUM(cl.n), 0) AS count,
+            ROUND(100.0 * COALESCE(SUM(cl.n), 0) / MAX((SELECT SUM(n) FROM classified), 1), 2) AS pct
         FROM categories c
         LEFT JOIN classified cl ON cl.board_class = c.board_class
         GROUP BY c.board_class, c.sort_order
@@ -202,9 +224,9 @@ QUERIES: list[tuple[str, str, str]] = [
         """
         SELECT
             outcome,
-            COUNT(*) AS frequency,
-            ROUND(100.0 * COUNT(*) / SUM(COUNT(*)) OVER(), 2) AS pct
-        FROM p2_responses
+            SUM(n) AS frequency,
+            ROUND(100.0 * SUM(n) / SUM(SUM(n)) OVER(), 2) AS pct
+        FROM p2_counts
         WHERE is_p1_win = 0 AND outcome != 'Draw'
         GROUP BY outcome
         ORDER BY frequency DESC
@@ -276,20 +298,29 @@ def run_query(conn: sqlite3.Connection, index: int) -> None:
         print(f"  Error: {e}\n")
 
 
-def check_db() -> bool:
-    """Check if the database exists and has data."""
-    if not os.path.exists(DB_PATH):
-        print(f"[!] Database not found at {DB_PATH}")
-        print("    Run the solver first: python src/main.py")
-        return False
-
+def open_db(raw: bool) -> sqlite3.Connection:
+    """Connect, with views over the raw tables in place of missing or unwanted rollups."""
     conn = sqlite3.connect(DB_PATH)
+    has_rollups = conn.execute(
+        "SELECT COUNT(*) FROM sqlite_master WHERE name = 'solution_counts'"
+    ).fetchone()[0]
+    if raw or not has_rollups:
+        if not raw:
+            print("[*] No rollup tables yet (the solver builds them on its next run): scanning raw rows")
+        conn.executescript(RAW_VIEWS)
+    return conn
+
+
+def check_db(conn: sqlite3.Connection) -> bool:
+    """Check that the database has data."""
     try:
-        count = conn.execute("SELECT COUNT(*) FROM solutions").fetchone()[0]
+        count, p2_count = conn.execute(
+            "SELECT COALESCE(SUM(n), 0), COALESCE(SUM(CASE WHEN has_p2_data = 1 THEN n END), 0) "
+            "FROM solution_counts"
+        ).fetchone()
         if count == 0:
             print("[!] Database is empty. Run the solver first: python src/main.py")
             return False
-        p2_count = conn.execute("SELECT COUNT(*) FROM solutions WHERE has_p2_data = 1").fetchone()[0]
         print(f"[*] Database: {DB_PATH}")
         print(f"[*] Boards solved: {count:,} ({p2_count:,} with P2 data)")
         return True
@@ -297,8 +328,6 @@ def check_db() -> bool:
         print("[!] Database exists but has no solutions table.")
         print("    Run the solver first: python src/main.py")
         return False
-    finally:
-        conn.close()
 
 
 def main() -> None:
@@ -315,6 +344,11 @@ def main() -> None:
         action="store_true",
         help="List all available queries.",
     )
+    parser.add_argument(
+        "--raw",
+        action="store_true",
+        help="Scan the raw tables instead of the rollups.",
+    )
     args = parser.parse_args()
 
     if args.list:
@@ -324,10 +358,15 @@ def main() -> None:
         print()
         return
 
-    if not check_db():
+    if not os.path.exists(DB_PATH):
+        print(f"[!] Database not found at {DB_PATH}")
+        print("    Run the solver first: python src/main.py")
         sys.exit(1)
 
-    conn = sqlite3.connect(DB_PATH)
+    conn = open_db(args.raw)
+    if not check_db(conn):
+        conn.close()
+        sys.exit(1)
 
     try:
         if args.query:
@@ -0,0 +1,575 @@
+"""
+Reproducible solver benchmarks over a fixed, checked-in board corpus.
+
+The corpus (bench/corpus.txt) is stratified by search difficulty, by P1
+result and by board self-symmetry; bench/golden.jsonl holds the full
+solution of every corpus board. Results are printed as JSON.
+
+Usage:
+    python bench/bench.py run                 # All benchmarks -> JSON on stdout
+    python bench/bench.py run --out b.json    # ... also written to a file
+    python bench/bench.py check               # Diff C and Python solvers against golden
+    python bench/bench.py sharing             # Shared position cache hit rates by depth
+    python bench/bench.py engines             # Alpha-beta vs df-pn, per board and on the tail
+    python bench/bench.py golden              # Rewrite golden from the C solver
+    python bench/bench.py corpus              # Regenerate the corpus (needs -DNIYA_STATS)
+
+Every engine change should pass `check` and report its `run` numbers
+before/after on the same machine.
+"""
+
+import argparse
+import ctypes
+import json
+import os
+import platform
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, os.path.join(ROOT, "src"))
+
+import solver
+import utils
+from models import SolveResult
+from solver import read_stats, solve_board, solve_boards
+from utils import Board, canonicalize_board, get_transforms
+
+BENCH_DIR = os.path.join(ROOT, "bench")
+CORPUS_PATH = os.path.join(BENCH_DIR, "corpus.txt")
+GOLDEN_PATH = os.path.join(BENCH_DIR, "golden.jsonl")
+
+TILES = [(p, s) for p in range(4) for s in range(4)]
+SYMMETRIC_TRIES = 500  # Random symmetric boards solved per one wanted, at most
+
+
+# ---------------------------------------------------------------------------
+# Corpus and golden file
+# ---------------------------------------------------------------------------
+
+def board_hex(board: Board) -> str:
+    """A board as 16 hex digits, one per cell: (plant << 2) | poem."""
+    return "".join(f"{(p << 2) | s:x}" for p, s in board)
+
+
+def board_from_hex(text: str) -> Board:
+    return [(int(c, 16) >> 2, int(c, 16) & 3) for c in text]
+
+
+def load_corpus(path: str = CORPUS_PATH) -> list[tuple[Board, list[str]]]:
+    """(board, tags) for every corpus line; '#' starts a comment."""
+    corpus = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split("#", 1)[0].split()
+            if fields:
+                corpus.append((board_from_hex(fields[0]), fields[1:]))
+    return corpus
+
+
+def result_record(result: SolveResult) -> dict:
+    """The fields of a SolveResult that the golden file pins down."""
+    return {
+        "best_move": result.best_move,
+        "is_p1_win": result.is_p1_win,
+        "is_draw": result.is_draw,
+        "outcome": result.outcome.value,
+        "game_depth": result.game_depth,
+        "p2": [[r.p1_move, r.p2_best_move, r.is_p1_win, r.outcome.value]
+               for r in result.p2_responses],
+    }
+
+
+def load_golden(path: str = GOLDEN_PATH) -> dict[str, dict]:
+    with open(path) as f:
+        return {rec.pop("board"): rec for rec in map(json.loads, f)}
+
+
+def write_golden(corpus: list[tuple[Board, list[str]]], path: str = GOLDEN_PATH) -> None:
+    results = solve_boards([board for board, _ in corpus], threads=0)
+    with open(path, "w") as f:
+        for (board, _), result in zip(corpus, results):
+            f.write(json.dumps({"board": board_hex(board), **result_record(result)}) + "\n")
+
+
+def normal_form(board: Board) -> tuple:
+    """Board with plants and poems relabeled in order of first appearance."""
+    plants: dict[int, int] = {}
+    poems: dict[int, int] = {}
+    return tuple((plants.setdefault(p, len(plants)), poems.setdefault(s, len(poems)))
+                 for p, s in board)
+
+
+def is_symmetric(board: Board) -> bool:
+    """True if a non-trivial spatial map and/or plant-poem swap fixes the board."""
+    base = normal_form(board)
+    for t, mapping in enumerate(get_transforms()):
+        moved = [board[i] for i in mapping]
+        if t > 0 and normal_form(moved) == base:
+            return True
+        if normal_form([(s, p) for p, s in moved]) == base:
+            return True
+    return False
+
+
+def symmetric_board(rng: random.Random) -> Board:
+    """
+    A random board fixed by a spatial involution (180° rotation, either
+    transpose or either flip) combined with a tile involution (relabeling or
+    plant-poem swap), i.e. a self-symmetric one.
+    """
+    rot180 = [15 - i for i in range(16)]
+    transpose = [4 * (i % 4) + i // 4 for i in range(16)]
+    anti_transpose = [15 - c for c in transpose]
+    flips = [[4 * (i // 4) + 3 - i % 4 for i in range(16)],
+             [4 * (3 - i // 4) + i % 4 for i in range(16)]]
+    involutions = [lambda p, s: (p ^ 1, s), lambda p, s: (s, p),
+                   lambda p, s: (p ^ 1, s ^ 2), lambda p, s: (3 - p, s)]
+    while True:
+        spatial = rng.choice([rot180, transpose, anti_transpose] + flips)
+        inv = rng.choice(involutions)
+        board: list = [None] * 16
+        used: set = set()
+        cells = list(range(16))
+        rng.shuffle(cells)
+        for cell in cells:
+            if board[cell] is not None:
+                continue
+            mate = spatial[cell]
+            options = [t for t in TILES if t not in used and
+                       (inv(*t) == t if mate == cell else inv(*t) != t and inv(*t) not in used)]
+            if not options:
+                break
+            tile = rng.choice(options)
+            board[cell] = tile
+            board[mate] = inv(*tile)
+            used.update((tile, inv(*tile)))
+        if len(used) == 16:
+            return list(canonicalize_board(board))
+
+
+def make_corpus(per_stratum: int, symmetric: int, sample: int, seed: int) -> list[tuple[Board, list[str]]]:
+    """
+    Sample random canonical boards, bucket them by P1 result and by node
+    count (terciles of the sample), and take `per_stratum` from each bucket,
+    plus `symmetric` self-symmetric boards spread over the terciles (they
+    search less, so most random ones are easy). Node counts make the strata
+    independent of the machine, so this needs a -DNIYA_STATS build.
+    """
+    rng = random.Random(seed)
+    boards = []
+    for _ in range(sample):
+        board = list(TILES)
+        rng.shuffle(board)
+        boards.append(list(canonicalize_board(board)))
+
+    def nodes_and_result(board: Board) -> tuple[int, SolveResult]:
+        read_stats()
+        result = solve_board(board, skip_canonical=True)
+        return read_stats().nodes, result
+
+    measured = [(board, *nodes_and_result(board)) for board in boards]
+    counts = sorted(nodes for _, nodes, _ in measured)
+    cut1, cut2 = counts[len(counts) // 3], counts[2 * len(counts) // 3]
+
+    def tags(board: Board, nodes: int, result: SolveResult) -> list[str]:
+        outcome = "draw" if result.is_draw else ("p1_win" if result.is_p1_win else "p2_win")
+        level = "easy" if nodes < cut1 else ("medium" if nodes < cut2 else "hard")
+        return [outcome, level] + (["symmetric"] if is_symmetric(board) else [])
+
+    buckets: dict[tuple, list] = {}
+    for board, nodes, result in measured:
+        t = tags(board, nodes, result)
+        buckets.setdefault(tuple(t[:2]), []).append((board, t))
+    corpus = []
+    for key in sorted(buckets):
+        corpus.extend(buckets[key][:per_stratum])
+    # Draw until each tercile has its share (the remainder going to the
+    # harder ones), giving up on one that hard symmetric boards rarely reach
+    levels = ("hard", "medium", "easy")
+    wanted = {level: symmetric // 3 + (i < symmetric % 3) for i, level in enumerate(levels)}
+    for _ in range(SYMMETRIC_TRIES * symmetric):
+        if not any(wanted.values()):
+            break
+        board = symmetric_board(rng)
+        t = tags(board, *nodes_and_result(board))
+        if wanted[t[1]]:
+            wanted[t[1]] -= 1
+            corpus.append((board, t))
+    for level in levels:
+        if wanted[level]:
+            print(f"[!] {wanted[level]} {level} symmetric boards short after "
+                  f"{SYMMETRIC_TRIES * symmetric} tries")
+    return corpus
+
+
+def write_corpus(corpus: list[tuple[Board, list[str]]], args: argparse.Namespace) -> None:
+    with open(CORPUS_PATH, "w") as f:
+        f.write("# Niya benchmark corpus: canonical board (16 hex cells, (plant << 2) | poem)\n")
+        f.write("# and tags: P1 result, node-count tercile, self-symmetry.\n")
+        f.write(f"# Generated by `bench.py corpus --seed {args.seed} --sample {args.sample} "
+                f"--per-stratum {args.per_stratum} --symmetric {args.symmetric}`.\n")
+        for board, tags in corpus:
+            f.write(f"{board_hex(board)} {' '.join(tags)}\n")
+
+
+# ---------------------------------------------------------------------------
+# Benchmarks
+# ---------------------------------------------------------------------------
+
+def percentile(sorted_values: list[float], q: float) -> float | None:
+    """Nearest-rank percentile of an ascending list."""
+    if not sorted_values:
+        return None
+    return sorted_values[min(len(sorted_values) - 1, int(q * len(sorted_values)))]
+
+
+def summarize(name: str, boards: int, seconds: float, latencies: list[float] | None = None,
+              nodes: int | None = None, **extra) -> dict:
+    """One machine-readable benchmark line (latencies in seconds)."""
+    lat = sorted(latencies) if latencies else []
+    return {
+        "name": name,
+        "boards": boards,
+        "seconds": round(seconds, 6),
+        "boards_per_sec": round(boards / seconds, 3) if seconds > 0 else None,
+        "nodes_per_sec": round(nodes / seconds) if nodes is not None and seconds > 0 else None,
+        "p50_ms": round(percentile(lat, 0.50) * 1e3, 4) if lat else None,
+        "p99_ms": round(percentile(lat, 0.99) * 1e3, 4) if lat else None,
+        **extra,
+    }
+
+
+def timed_per_board(fn, boards: list[Board], repeat: int) -> tuple[float, list[float], int | None]:
+    """Call fn(board) for each board `repeat` times. Returns (total, latencies, nodes)."""
+    read_stats()
+    latencies = []
+    for _ in range(repeat):
+        for board in boards:
+            t0 = time.perf_counter()
+            fn(board)
+            latencies.append(time.perf_counter() - t0)
+    stats = read_stats()
+    return sum(latencies), latencies, stats.nodes if stats else None
+
+
+def bench_canonicalize(corpus_boards: list[Board], repeat: int) -> dict:
+    """canonicalize_board_c on shuffled members of each corpus board's class."""
+    rng = random.Random(1)
+    inputs = []
+    for board in corpus_boards:
+        plant_map, poem_map = rng.sample(range(4), 4), rng.sample(range(4), 4)
+        mapping = rng.choice(get_transforms())
+        member = [(plant_map[board[i][0]], poem_map[board[i][1]]) for i in mapping]
+        inputs.append(((ctypes.c_int8 * 16)(*(p for p, _ in member)),
+                       (ctypes.c_int8 * 16)(*(s for _, s in member))))
+    out_p, out_s = (ctypes.c_int8 * 16)(), (ctypes.c_int8 * 16)()
+    fn = utils._c_canonicalize
+
+    latencies = []
+    for _ in range(repeat):
+        for plants, poems in inputs:
+            t0 = time.perf_counter()
+            fn(plants, poems, out_p, out_s)
+            latencies.append(time.perf_counter() - t0)
+    return summarize("canonicalize_board_c", len(latencies), sum(latencies), latencies,
+                     note="latency includes ctypes call overhead")
+
+
+def bench_pipeline(boards: int, threads: int) -> dict:
+    """Time `main.py --skip-p2 --target N` end to end against a scratch data dir."""
+    with tempfile.TemporaryDirectory() as data_dir:
+        env = dict(os.environ, NIYA_DATA_DIR=data_dir)
+        cmd = [sys.executable, os.path.join(ROOT, "src", "main.py"), "--skip-p2",
+               "--target", str(boards), "--workers", str(threads)]
+        t0 = time.perf_counter()
+        subprocess.run(cmd, env=env, check=True, stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL)
+        seconds = time.perf_counter() - t0
+    return summarize("main_py_pipeline_p1", boards, seconds, threads=threads,
+                     note="includes interpreter startup and SQLite writes")
+
+
+def git_revision() -> str | None:
+    try:
+        return subprocess.run(["git", "-C", ROOT, "rev-parse", "--short", "HEAD"],
+                              capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def run(args: argparse.Namespace) -> dict:
+    corpus = load_corpus()
+    boards = [board for board, _ in corpus]
+    threads = args.threads or os.cpu_count() or 1
+    results = []
+
+    if utils._c_canonicalize is not None:
+        results.append(bench_canonicalize(boards, args.repeat * 20))
+    if solver._c_lib is not None:
+        for skip_p2 in (True, False):
+            label = "p1" if skip_p2 else "full"
+            total, lat, nodes = timed_per_board(
+                lambda b: solver._solve_board_c(b, skip_p2), boards, args.repeat)
+            results.append(summarize(f"solve_board_c_{label}", len(lat), total, lat, nodes))
+
+            total, lat, nodes = timed_per_board(
+                lambda b: solver._solve_board_c(b, skip_p2, threads), boards, args.repeat)
+            results.append(summarize(f"solve_board_parallel_{label}", len(lat), total, lat,
+                                     nodes, threads=threads))
+
+            read_stats()
+            t0 = time.perf_counter()
+            for _ in range(args.repeat):
+                solve_boards(boards, skip_p2=skip_p2, threads=threads)
+            seconds = time.perf_counter() - t0
+            stats = read_stats()
+            results.append(summarize(f"solve_boards_batch_{label}", len(boards) * args.repeat,
+                                     seconds, nodes=stats.nodes if stats else None,
+                                     threads=threads))
+
+    if args.python:
+        # Lightest boards first, so the fallback finishes in reasonable time
+        easy = [b for b, tags in corpus if "easy" in tags] or boards
+        total, lat, _ = timed_per_board(
+            lambda b: solver._solve_board_python(b, {}, True), easy[:args.python], 1)
+        results.append(summarize("python_minimax_p1", len(lat), total, lat))
+
+    if args.pipeline and solver.has_native_batch():
+        results.append(bench_pipeline(args.pipeline, threads))
+
+    return {
+        "meta": {
+            "git": git_revision(),
+            "python": platform.python_version(),
+            "machine": platform.machine(),
+            "cpus": os.cpu_count(),
+            "c_solver": solver._c_lib is not None,
+            "stats_build": read_stats() is not None,
+            "corpus": len(corpus),
+            "repeat": args.repeat,
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        },
+        "results": results,
+    }
+
+
+def sharing(args: argparse.Namespace) -> dict:
+    """
+    Shared position cache at each depth: hit rate with the table emptied
+    before every board (repeats within one solve only) and kept for the
+    whole corpus (what a batch worker sees), with nodes and time against
+    the cache turned off.
+    """
+    boards = [board for board, _ in load_corpus()]
+    skip_p2 = args.skip_p2
+    results = []
+
+    def batch(name: str, depth: int) -> dict:
+        solver.configure_position_cache(depth, args.mb)
+        read_stats()
+        t0 = time.perf_counter()
+        solve_boards(boards, skip_p2=skip_p2, threads=args.threads)
+        seconds = time.perf_counter() - t0
+        stats = read_stats()
+        extra = {"depth": depth}
+        if stats:
+            extra.update(search_nodes=stats.nodes, pc_probes=stats.pc_probes,
+                         pc_hit_rate=round(stats.pc_hit_rate, 4))
+        return summarize(name, len(boards), seconds, **extra)
+
+    off = batch("position_cache_off", 0)
+    results.append(off)
+    for depth in args.depths:
+        read_stats()
+        for board in boards:
+            solver.configure_position_cache(depth, args.mb)
+            solver._solve_board_c(board, skip_p2)
+        stats = read_stats()
+        shared = batch("position_cache_shared", depth)
+        if stats:
+            shared["per_board_hit_rate"] = round(stats.pc_hit_rate, 4)
+            shared["node_ratio"] = round(shared["search_nodes"] / off["search_nodes"], 4)
+        shared["time_ratio"] = round(shared["seconds"] / off["seconds"], 4)
+        results.append(shared)
+    solver.configure_position_cache(0)
+
+    return {
+        "meta": {"git": git_revision(), "corpus": len(boards), "skip_p2": skip_p2,
+                 "mb": args.mb, "stats_build": read_stats() is not None},
+        "results": results,
+    }
+
+
+def engines(args: argparse.Namespace) -> dict:
+    """
+    Alpha-beta against df-pn, board by board: latency percentiles, nodes,
+    and both engines on the boards that are slowest under alpha-beta (the
+    long tail that sets p99).
+    """
+    boards = [board for board, _ in load_corpus()]
+    latency: dict[str, list[float]] = {}
+    nodes: dict[str, list[int]] = {}
+    for engine in solver.ENGINES:
+        latency[engine], nodes[engine] = [], []
+        for board in boards:
+            read_stats()
+            best = float("inf")
+            for _ in range(args.repeat):
+                t0 = time.perf_counter()
+                solver._solve_board_c(board, args.skip_p2, engine=engine)
+                best = min(best, time.perf_counter() - t0)
+            stats = read_stats()
+            latency[engine].append(best)
+            nodes[engine].append(stats.nodes // args.repeat if stats else 0)
+
+    nodes_known = read_stats() is not None
+    tail = sorted(range(len(boards)), key=lambda i: -latency["alphabeta"][i])
+    tail = tail[:max(1, int(len(boards) * args.tail))]
+    results = []
+    for engine in solver.ENGINES:
+        lat = latency[engine]
+        results.append(summarize(
+            engine, len(boards), sum(lat), lat,
+            max_ms=round(max(lat) * 1e3, 4),
+            search_nodes=sum(nodes[engine]) if nodes_known else None,
+            tail_seconds=round(sum(lat[i] for i in tail), 6),
+            tail_nodes=sum(nodes[engine][i] for i in tail) if nodes_known else None,
+            faster_boards=sum(lat[i] < min(latency[e][i] for e in solver.ENGINES if e != engine)
+                              for i in range(len(boards))),
+        ))
+    return {
+        "meta": {"git": git_revision(), "corpus": len(boards), "skip_p2": args.skip_p2,
+                 "repeat": args.repeat, "tail_boards": len(tail), "stats_build": nodes_known,
+                 "note": "latency is the best of `repeat` solves per board; tail_* sum the "
+                         "boards slowest under alpha-beta"},
+        "results": results,
+    }
+
+
+def check(args: argparse.Namespace) -> bool:
+    """Diff the C solver (all boards) and the Python fallback (some) against golden."""
+    corpus = load_corpus()
+    golden = load_golden()
+    boards = [board for board, _ in corpus]
+    failures = 0
+
+    def compare(label: str, board: Board, result: SolveResult, skip_p2: bool) -> None:
+        nonlocal failures
+        want = dict(golden[board_hex(board)])
+        got = result_record(result)
+        if skip_p2:
+            want["p2"] = []
+        if got != want:
+            failures += 1
+            diff = {k: (got[k], want[k]) for k in want if got[k] != want[k]}
+            print(f"[!] {label} {board_hex(board)}: (got, want) {diff}")
+
+    checked = 0
+    if solver._c_lib is not None:
+        for skip_p2 in (False, True):
+            label = "C p1" if skip_p2 else "C full"
+            for board, result in zip(boards, solve_boards(boards, skip_p2=skip_p2, threads=0)):
+                compare(f"{label} batch", board, result, skip_p2)
+            for board in boards:
+                compare(label, board, solver._solve_board_c(board, skip_p2), skip_p2)
+                compare(f"{label} parallel", board,
+                        solver._solve_board_c(board, skip_p2, args.threads), skip_p2)
+            for board, result in zip(boards, solve_boards(boards, skip_p2=skip_p2, threads=0,
+                                                          engine="dfpn")):
+                compare(f"{label} df-pn batch", board, result, skip_p2)
+            checked += 4 * len(boards)
+    for board in boards[:args.python]:
+        compare("Python full", board, solver._solve_board_python(board, {}, False), False)
+        checked += 1
+
+    print(f"[*] {checked:,} solves checked against {GOLDEN_PATH}: "
+          f"{'OK' if failures == 0 else f'{failures} mismatches'}")
+    return failures == 0
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Niya solver benchmarks.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    run_p = sub.add_parser("run", help="Run the benchmarks and print JSON.")
+    run_p.add_argument("--threads", type=int, default=0,
+                       help="Threads for batch and pipeline runs (default: CPU count).")
+    run_p.add_argument("--repeat", type=int, default=3,
+                       help="Passes over the corpus per C benchmark (default: 3).")
+    run_p.add_argument("--python", type=int, default=4,
+                       help="Easy boards for the Python fallback, P1 only (default: 4).")
+    run_p.add_argument("--pipeline", type=int, default=2000,
+                       help="Boards for the main.py pipeline run, 0 to skip (default: 2000).")
+    run_p.add_argument("--out", default=None, help="Also write the JSON to this file.")
+
+    check_p = sub.add_parser("check", help="Diff solver results against the golden file.")
+    check_p.add_argument("--threads", type=int, default=4,
+                         help="Threads for the parallel single-board solver (default: 4).")
+    check_p.add_argument("--python", type=int, default=8,
+                         help="Corpus boards also solved by the Python fallback (default: 8).")
+
+    sharing_p = sub.add_parser("sharing", help="Measure the shared position cache "
+                               "(hit rates need -DNIYA_STATS).")
+    sharing_p.add_argument("--depths", type=int, nargs="+", default=[8, 9, 10, 11, 12],
+                           help="Cache depths to try (default: 8 9 10 11 12).")
+    sharing_p.add_argument("--mb", type=int, default=solver.DEFAULT_POSITION_CACHE_MB,
+                           help="Cache size in MB (default: %(default)s).")
+    sharing_p.add_argument("--threads", type=int, default=1,
+                           help="Batch solver threads (default: 1).")
+    sharing_p.add_argument("--skip-p2", action="store_true", help="P1 only.")
+
+    engines_p = sub.add_parser("engines", help="Compare alpha-beta and df-pn per board "
+                               "(node counts need -DNIYA_STATS).")
+    engines_p.add_argument("--repeat", type=int, default=3,
+                           help="Solves per board, best time kept (default: 3).")
+    engines_p.add_argument("--tail", type=float, default=0.1,
+                           help="Share of slowest alpha-beta boards in the tail (default: 0.1).")
+    engines_p.add_argument("--skip-p2", action="store_true", help="P1 only.")
+
+    sub.add_parser("golden", help="Rewrite the golden file from the C solver.")
+
+    corpus_p = sub.add_parser("corpus", help="Regenerate the corpus (-DNIYA_STATS build).")
+    corpus_p.add_argument("--seed", type=int, default=2024)
+    corpus_p.add_argument("--sample", type=int, default=3000,
+                          help="Random boards to stratify (default: 3000).")
+    corpus_p.add_argument("--per-stratum", type=int, default=8,
+                          help="Boards per (result, difficulty) stratum (default: 8).")
+    corpus_p.add_argument("--symmetric", type=int, default=16,
+                          help="Extra self-symmetric boards (default: 16).")
+
+    args = parser.parse_args()
+    if args.command == "run":
+        report = run(args)
+        text = json.dumps(report, indent=2)
+        print(text)
+        if args.out:
+            with open(args.out, "w") as f:
+                f.write(text + "\n")
+    elif args.command == "check":
+        sys.exit(0 if check(args) else 1)
+    elif args.command == "engines":
+        if solver._c_lib is None:
+            sys.exit("[!] Both engines are part of the C solver (src/solver_core.so)")
+        print(json.dumps(engines(args), indent=2))
+    elif args.command == "sharing":
+        if solver._c_lib is None:
+            sys.exit("[!] The position cache is part of the C solver (src/solver_core.so)")
+        print(json.dumps(sharing(args), indent=2))
+    elif args.command == "golden":
+        if solver._c_lib is None:
+            sys.exit("[!] The golden file is written by the C solver (src/solver_core.so)")
+        write_golden(load_corpus())
+        print(f"[*] Wrote {GOLDEN_PATH}")
+    else:
+        if read_stats() is None:
+            sys.exit("[!] Corpus strata use node counts: build solver_core.so with -DNIYA_STATS")
+        write_corpus(make_corpus(args.per_stratum, args.symmetric, args.sample, args.seed), args)
+        print(f"[*] Wrote {CORPUS_PATH}")
+
+
+if __name__ == "__main__":
+    main()
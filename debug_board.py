@@ -5,7 +5,10 @@ import os
 import time
 
 sys.path.append(os.path.join(os.path.dirname(__file__), "src"))
-from utils import get_permutation, print_board, is_canonical, PLANTS, POEMS, Board
+from utils import (
+    get_permutation, print_board, is_canonical, PLANTS, POEMS, Board,
+    canonicalize_board, canonicalize_board_bruteforce, canonicalize_board_python,
+)
 from solver import solve_board
 from models import Outcome, SolveResult
 
@@ -69,7 +72,31 @@ def print_p2_table(result: SolveResult) -> None:
     print("=" * 50)
 
 
-def main(perm_index: int | None, explore_canonical: bool, verbose: bool) -> None:
+def check_canonicalizer(samples: int) -> bool:
+    """
+    Cross-check the fast canonicalizers (C and pure Python) against the
+    9,216-transform brute force on random boards.
+    """
+    print(f"[*] Checking canonicalize_board against brute force on {samples:,} boards...")
+    mismatches = 0
+    for _ in range(samples):
+        board = list(TILES)
+        random.shuffle(board)
+        expected = canonicalize_board_bruteforce(board)
+        for name, fn in (("canonicalize_board", canonicalize_board),
+                         ("canonicalize_board_python", canonicalize_board_python)):
+            got = fn(board)
+            if got != expected:
+                mismatches += 1
+                print(f"[!] {name} mismatch for board {board}")
+                print(f"    got      {got}")
+                print(f"    expected {expected}")
+    if mismatches == 0:
+        print("[*] All canonical forms match.")
+    return mismatches == 0
+
+
+def main(perm_index: int | None, explore_canonical: bool, verbose: bool, threads: int) -> None:
     """
     Debugs the solver for a single board permutation.
     """
@@ -99,7 +126,7 @@ def main(perm_index: int | None, explore_canonical: bool, verbose: bool) -> None
     # --- Solve ---
     print("\n[*] Solving...")
     start_time = time.perf_counter()
-    result = solve_board(board, debug=verbose, skip_canonical=True)
+    result = solve_board(board, debug=verbose, skip_canonical=True, threads=threads)
     elapsed = time.perf_counter() - start_time
 
     # --- Display results ---
@@ -134,6 +161,22 @@ if __name__ == "__main__":
         action="store_true",
         help="If set, prints the full minimax debug trace.",
     )
+    parser.add_argument(
+        "--threads",
+        type=int,
+        default=1,
+        help="Threads to spread the C solve of this board over (0 = one per CPU, default: 1).",
+    )
+    parser.add_argument(
+        "--check-canonical",
+        type=int,
+        metavar="N",
+        default=None,
+        help="Cross-check the canonicalizer against brute force on N random boards and exit.",
+    )
     args = parser.parse_args()
 
-    main(args.perm_index, args.find_canonical, args.verbose)
+    if args.check_canonical is not None:
+        sys.exit(0 if check_canonicalizer(args.check_canonical) else 1)
+
+    main(args.perm_index, args.find_canonical, args.verbose, args.threads)
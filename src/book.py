@@ -0,0 +1,130 @@
+"""
+Opening book for the web AI: the solved best first move of every board
+and the best reply to each opening, exported so the browser can play the
+first two plies of a solved board without searching.
+
+The book is one sorted file of fixed-width entries keyed by the canonical
+board. Canonical boards sort in enumeration order, so the entries are in
+dense rank order (utils.board_rank) without the browser needing the rank
+table. A small block index at the front lets the client fetch only the
+block an entry is in, with one HTTP range request.
+
+Book layout (little-endian):
+    magic        8s   b"NIYABOOK"
+    version      u16  BOOK_VERSION
+    record_size  u16  shards.P2_RECORD_SIZE
+    block_size   u32  entries per block
+    count        u32  number of entries
+    index        u64 key of the first entry of each block (ceil(count /
+                 block_size) keys, stored big-endian like the keys below)
+    entries      count x (key, record)
+
+Key: the canonical board as 16 nibbles (plant << 2) | poem, cell 0 in the
+high nibble of the first byte. Keys are big-endian so that comparing the
+bytes compares the boards. Record: a shard record with P2 data (see
+shards.py); has_p2 is clear when the board has no P2 responses.
+
+Usage:
+    python src/book.py                              # niya.db -> web/public/opening_book.bin
+    python src/book.py --shards data/results.shards  # Also read a shard log (needs the rank table)
+"""
+
+import argparse
+import os
+import sqlite3
+import struct
+
+from database import DB_PATH
+from shards import (P2_RECORD_SIZE, SHARD_LOG_PATH, SHARD_RANKED, _pack_record, _record_size,
+                    iter_shard_log)
+from utils import (board_unrank, cursor_at_rank, enumerate_canonical, get_permutation,
+                   load_rank_table)
+
+BOOK_MAGIC = b"NIYABOOK"
+BOOK_VERSION = 1
+BOOK_BLOCK_SIZE = 1024
+
+BOOK_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                         "..", "web", "public", "opening_book.bin")
+
+_HEADER = struct.Struct("<8sHHII")
+_TILES = [(p, s) for p in range(4) for s in range(4)]
+
+
+def board_key(board) -> bytes:
+    """Book key of a canonical board."""
+    return bytes((board[i][0] << 6 | board[i][1] << 4 | board[i + 1][0] << 2 | board[i + 1][1])
+                 for i in range(0, 16, 2))
+
+
+def db_entries(db_path: str = DB_PATH) -> dict[bytes, bytes]:
+    """Book entries (key -> record) for every board in niya.db."""
+    conn = sqlite3.connect(db_path)
+    p2_by_index: dict[int, list[tuple]] = {}
+    for row in conn.execute("SELECT * FROM p2_responses"):
+        p2_by_index.setdefault(row[0], []).append(row)
+
+    entries = {}
+    for solution in conn.execute("SELECT * FROM solutions"):
+        key = board_key(get_permutation(_TILES, solution[0]))
+        entries[key] = _pack_record(solution, p2_by_index.get(solution[0], []), with_p2=True)
+    conn.close()
+    return entries
+
+
+def shard_entries(path: str) -> dict[bytes, bytes]:
+    """Book entries for every board in a shard log (needs the rank table)."""
+    entries = {}
+    for shard, _ in iter_shard_log(path):
+        ranked = shard.flags & SHARD_RANKED
+        if ranked:
+            boards = [board_unrank(rank) for rank in shard.ranks()]
+        else:
+            boards, _ = enumerate_canonical(cursor_at_rank(shard.start_rank), shard.count)
+        size = _record_size(shard.flags)
+        skip = 4 if ranked else 0
+        for i, board in enumerate(boards):
+            base = i * (skip + size) + skip
+            # P1-only records have has_p2 clear, so padding them is enough
+            entries[board_key(board)] = shard.body[base:base + size].ljust(P2_RECORD_SIZE, b"\0")
+    return entries
+
+
+def write_book(entries: dict[bytes, bytes], path: str = BOOK_PATH,
+               block_size: int = BOOK_BLOCK_SIZE) -> int:
+    """Write the book to `path`. Returns the number of entries."""
+    keys = sorted(entries)
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(_HEADER.pack(BOOK_MAGIC, BOOK_VERSION, P2_RECORD_SIZE, block_size, len(keys)))
+        f.write(b"".join(keys[i] for i in range(0, len(keys), block_size)))
+        for key in keys:
+            f.write(key + entries[key])
+    return len(keys)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Export the web AI's opening book.")
+    parser.add_argument("path", nargs="?", default=BOOK_PATH,
+                        help="Output file (default: web/public/opening_book.bin).")
+    parser.add_argument("--shards", nargs="?", const=SHARD_LOG_PATH, default=None,
+                        help="Also read a shard log (default: data/results.shards).")
+    parser.add_argument("--block-size", type=int, default=BOOK_BLOCK_SIZE,
+                        help=f"Entries per range request (default: {BOOK_BLOCK_SIZE}).")
+    args = parser.parse_args()
+
+    entries = db_entries() if os.path.exists(DB_PATH) else {}
+    if args.shards:
+        if not load_rank_table():
+            raise SystemExit("[!] No rank table: run `python src/main.py --build-rank-table` first")
+        entries.update(shard_entries(args.shards))
+    if not entries:
+        raise SystemExit("[!] No solved boards to export")
+
+    count = write_book(entries, args.path, args.block_size)
+    size = os.path.getsize(args.path)
+    print(f"[*] Wrote {count:,} boards to {args.path} ({size:,} bytes)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,326 @@
+"""
+Multi-node campaign: one coordinator hands out ranges of dense class ranks
+(see utils.board_rank) as leases; workers on any number of machines solve
+their range with the native batch solver and send back a result shard
+(see shards.py), which the coordinator appends to data/results.shards.
+
+A lease expires unless the worker heartbeats, and expired ranges go to the
+next worker that asks, so preempted nodes lose at most one range of work.
+The first valid shard for a range is kept; later ones (from a worker that
+was presumed dead) are dropped. `python src/shards.py import` loads the
+log into niya.db for analyze.py.
+
+Usage:
+    python src/campaign.py coordinator --port 8765        # needs data/rank_table.bin
+    python src/campaign.py worker --url http://host:8765  # needs src/solver_core.so
+
+Coordinator settings (range size, lease length, P2 analysis) apply to the
+whole campaign; workers learn them from each lease.
+"""
+
+import argparse
+import json
+import os
+import socket
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from http import HTTPStatus
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from database import (SolvedSet, claim_lease, complete_lease, get_lease,
+                      get_lease_summary, init_db, renew_lease)
+from main import open_solved_set, solve_samples
+from shards import SHARD_LOG_PATH, ShardError, append_shard, decode_shard, encode_shard
+from solver import DEFAULT_TT_MB, check_tt_mb, configure_tt, has_native_batch
+from utils import cursor_at_rank, enumerate_canonical, load_rank_table, perm_indexes_of
+
+DEFAULT_PORT = 8765
+DEFAULT_RANGE_SIZE = 50_000     # ~2 min per range on an 8-core box, P1 only
+DEFAULT_LEASE_SECONDS = 120
+
+
+# ---------------------------------------------------------------------------
+# Coordinator
+# ---------------------------------------------------------------------------
+
+class Coordinator:
+    """
+    Lease bookkeeping behind the HTTP handler. Leases live in niya.db,
+    results in the shard log.
+    """
+
+    def __init__(self, n_classes: int, range_size: int, lease_seconds: float,
+                 skip_p2: bool, solved: SolvedSet | None, log_path: str) -> None:
+        self.n_classes = n_classes
+        self.range_size = range_size
+        self.lease_seconds = lease_seconds
+        self.skip_p2 = skip_p2
+        self.solved = solved
+        self.log_path = log_path
+        self.import_lock = threading.Lock()
+
+    def lease(self, worker: str) -> dict:
+        """Next range for `worker`, {"retry": s} if none is free, or {"done": True}."""
+        claim = claim_lease(worker, self.range_size, self.n_classes,
+                            self.lease_seconds, time.time())
+        if claim is None:
+            done, _, _ = get_lease_summary()
+            if done >= self.n_classes:
+                return {"done": True}
+            return {"retry": min(30.0, self.lease_seconds / 2)}
+
+        start, end, token = claim
+        print(f"[*] Leased ranks {start:,}-{end:,} to {worker} (token {token})")
+        return {
+            "start": start,
+            "end": end,
+            "token": token,
+            "cursor": cursor_at_rank(start).hex(),
+            "skip_p2": self.skip_p2,
+            "lease_seconds": self.lease_seconds,
+        }
+
+    def heartbeat(self, start: int, token: int) -> bool:
+        return renew_lease(start, token, self.lease_seconds, time.time())
+
+    def result(self, start: int, data: bytes) -> HTTPStatus:
+        """Store a range's shard. GONE if the range is already done."""
+        try:
+            shard, size = decode_shard(data)
+        except ShardError:
+            return HTTPStatus.BAD_REQUEST
+        lease = get_lease(start)
+        if (lease is None or size != len(data) or shard.start_rank != start
+                or shard.count != lease[0] - start or shard.has_p2 == self.skip_p2):
+            return HTTPStatus.BAD_REQUEST
+        end = lease[0]
+
+        # The shard is durable before the range is marked done; a crash in
+        # between only leaves a duplicate shard, which imports as a no-op
+        with self.import_lock:
+            if get_lease(start)[1] == "done":
+                return HTTPStatus.GONE
+            append_shard(self.log_path, data)
+            complete_lease(start)
+            if self.solved is not None:
+                for rank in range(start, end):
+                    self.solved.add(rank)
+                self.solved.flush()
+
+        done, leased, _ = get_lease_summary()
+        print(f"[*] Stored ranks {start:,}-{end:,}: {done:,} / {self.n_classes:,} "
+              f"done ({100 * done / self.n_classes:.4f}%), {leased:,} leased")
+        return HTTPStatus.OK
+
+
+class _Handler(BaseHTTPRequestHandler):
+    """POST /lease, /heartbeat and /result?start= for one Coordinator."""
+
+    coordinator: Coordinator
+
+    def do_POST(self) -> None:
+        url = urllib.parse.urlsplit(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        try:
+            if url.path == "/lease":
+                self._reply(HTTPStatus.OK, self.coordinator.lease(json.loads(body)["worker"]))
+            elif url.path == "/heartbeat":
+                msg = json.loads(body)
+                alive = self.coordinator.heartbeat(int(msg["start"]), int(msg["token"]))
+                self._reply(HTTPStatus.OK if alive else HTTPStatus.GONE)
+            elif url.path == "/result":
+                self._reply(self.coordinator.result(int(query["start"][0]), body))
+            else:
+                self._reply(HTTPStatus.NOT_FOUND)
+        except (ValueError, KeyError, TypeError):
+            self._reply(HTTPStatus.BAD_REQUEST)
+
+    def _reply(self, status: HTTPStatus, payload: dict | None = None) -> None:
+        data = json.dumps(payload or {}).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, format: str, *args) -> None:
+        pass    # the coordinator prints its own one-line events
+
+
+def run_coordinator(args: argparse.Namespace) -> None:
+    n_classes = load_rank_table()
+    if not n_classes:
+        raise SystemExit("[!] No rank table: run `python src/main.py --build-rank-table` first")
+    init_db()
+    solved = open_solved_set()
+
+    _Handler.coordinator = Coordinator(n_classes, args.range_size, args.lease_seconds,
+                                       args.skip_p2, solved, args.log)
+    done, leased, _ = get_lease_summary()
+    mode = "P1 only (fast)" if args.skip_p2 else "P1 + P2 analysis"
+    print(f"[*] Niya campaign coordinator - {mode}")
+    print(f"[*] {n_classes:,} classes, ranges of {args.range_size:,}, "
+          f"{args.lease_seconds:g}s leases -> {args.log}")
+    if done or leased:
+        print(f"[*] Resuming: {done:,} ranks done, {leased:,} leased")
+    print(f"[*] Listening on {args.host}:{args.port} (Ctrl+C to stop)\n")
+
+    server = ThreadingHTTPServer((args.host, args.port), _Handler)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\n[*] Stopped. Open leases stay valid until they expire.")
+    finally:
+        server.server_close()
+        if solved is not None:
+            solved.close()
+
+
+# ---------------------------------------------------------------------------
+# Worker
+# ---------------------------------------------------------------------------
+
+def _post(url: str, body: bytes, content_type: str = "application/json") -> tuple[int, dict]:
+    """POST and return (status, JSON reply). Raises URLError if unreachable."""
+    request = urllib.request.Request(url, data=body, headers={"Content-Type": content_type})
+    try:
+        with urllib.request.urlopen(request, timeout=60) as reply:
+            return reply.status, json.loads(reply.read() or b"{}")
+    except urllib.error.HTTPError as err:
+        return err.code, {}
+
+
+class _Heartbeat(threading.Thread):
+    """Renews a lease every third of its length; sets `lost` if it is gone."""
+
+    def __init__(self, url: str, lease: dict) -> None:
+        super().__init__(daemon=True)
+        self.url = url
+        self.body = json.dumps({"start": lease["start"], "token": lease["token"]}).encode()
+        self.interval = lease["lease_seconds"] / 3
+        self.stopped = threading.Event()
+        self.lost = threading.Event()
+
+    def run(self) -> None:
+        while not self.stopped.wait(self.interval):
+            try:
+                status, _ = _post(self.url + "/heartbeat", self.body)
+            except (urllib.error.URLError, OSError):
+                continue    # coordinator briefly unreachable; keep solving
+            if status == HTTPStatus.GONE:
+                self.lost.set()
+                return
+
+
+def solve_lease(url: str, lease: dict, threads: int, batch_size: int) -> bytes | None:
+    """Solve a leased range. Returns its shard, or None if the lease was lost."""
+    start, end, skip_p2 = lease["start"], lease["end"], lease["skip_p2"]
+    heartbeat = _Heartbeat(url, lease)
+    heartbeat.start()
+    try:
+        cursor = bytes.fromhex(lease["cursor"])
+        rows: list[tuple[list[tuple], list[tuple]]] = []
+        remaining = end - start
+        while remaining > 0:
+            if heartbeat.lost.is_set():
+                return None
+            boards, cursor = enumerate_canonical(cursor, min(batch_size, remaining))
+            samples = list(zip(perm_indexes_of(boards), boards))
+            rows.extend(solve_samples(samples, skip_p2, threads))
+            remaining -= len(boards)
+            if len(boards) == 0:
+                break
+        return encode_shard(rows, with_p2=not skip_p2, start_rank=start)
+    finally:
+        heartbeat.stopped.set()
+
+
+def run_worker(args: argparse.Namespace) -> None:
+    if not has_native_batch():
+        raise SystemExit("[!] Workers need the C solver (src/solver_core.so)")
+    check_tt_mb(args.tt_mb, args.workers)
+    configure_tt(args.tt_mb)
+    url = args.url.rstrip("/")
+    name = args.name or f"{socket.gethostname()}:{os.getpid()}"
+    batch_size = 64 * args.workers
+    lease_body = json.dumps({"worker": name}).encode()
+
+    print(f"[*] Niya campaign worker {name}: {args.workers} threads -> {url}\n")
+    try:
+        while True:
+            try:
+                status, lease = _post(url + "/lease", lease_body)
+            except (urllib.error.URLError, OSError) as err:
+                print(f"[!] Coordinator unreachable ({err}); retrying in 30s")
+                time.sleep(30)
+                continue
+            if lease.get("done"):
+                print("[*] Campaign complete.")
+                return
+            if status != HTTPStatus.OK or "start" not in lease:
+                time.sleep(lease.get("retry", 30))
+                continue
+
+            t0 = time.monotonic()
+            shard = solve_lease(url, lease, args.workers, batch_size)
+            span = f"{lease['start']:,}-{lease['end']:,}"
+            if shard is None:
+                print(f"[!] Lease on ranks {span} was reassigned; dropped it")
+                continue
+
+            # Keep retrying the upload: the range is solved, only the wire failed
+            while True:
+                try:
+                    status, _ = _post(f"{url}/result?start={lease['start']}", shard,
+                                      "application/octet-stream")
+                    break
+                except (urllib.error.URLError, OSError) as err:
+                    print(f"[!] Upload failed ({err}); retrying in 30s")
+                    time.sleep(30)
+            rate = (lease["end"] - lease["start"]) / (time.monotonic() - t0)
+            verdict = {HTTPStatus.OK: "accepted", HTTPStatus.GONE: "already done"}.get(
+                status, f"rejected ({status})")
+            print(f"[*] Ranks {span}: {rate:,.0f} boards/s, {len(shard):,} byte shard {verdict}")
+    except KeyboardInterrupt:
+        print("\n[*] Stopped. The current lease expires and is reassigned.")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Niya multi-node campaign.")
+    sub = parser.add_subparsers(dest="role", required=True)
+
+    coord = sub.add_parser("coordinator", help="Hand out rank-range leases and import results.")
+    coord.add_argument("--host", default="0.0.0.0", help="Address to listen on (default: all).")
+    coord.add_argument("--port", type=int, default=DEFAULT_PORT,
+                       help=f"Port to listen on (default: {DEFAULT_PORT}).")
+    coord.add_argument("--range-size", type=int, default=DEFAULT_RANGE_SIZE,
+                       help=f"Ranks per newly opened lease (default: {DEFAULT_RANGE_SIZE:,}).")
+    coord.add_argument("--lease-seconds", type=float, default=DEFAULT_LEASE_SECONDS,
+                       help="Seconds a lease survives without a heartbeat "
+                            f"(default: {DEFAULT_LEASE_SECONDS}).")
+    coord.add_argument("--skip-p2", action="store_true",
+                       help="Workers skip P2 analysis (P1 results only).")
+    coord.add_argument("--log", default=SHARD_LOG_PATH,
+                       help="Shard log to append results to (default: data/results.shards).")
+
+    work = sub.add_parser("worker", help="Solve leased ranges for a coordinator.")
+    work.add_argument("--url", required=True, help="Coordinator URL, e.g. http://host:8765.")
+    work.add_argument("--workers", type=int, default=os.cpu_count(),
+                      help="Native solver threads (default: CPU count).")
+    work.add_argument("--tt-mb", type=int, default=DEFAULT_TT_MB,
+                      help=f"Transposition table size per thread in MB (default: {DEFAULT_TT_MB}).")
+    work.add_argument("--name", default=None, help="Worker name in logs (default: host:pid).")
+
+    args = parser.parse_args()
+    if args.role == "coordinator":
+        run_coordinator(args)
+    else:
+        run_worker(args)
+
+
+if __name__ == "__main__":
+    main()
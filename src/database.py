@@ -4,12 +4,16 @@ SQLite storage for solver results.
 If the schema changes during development, just delete data/niya.db and re-run.
 """
 
+import mmap
+import queue
 import sqlite3
 import os
+import threading
 
-DB_PATH = os.path.join(
-    os.path.dirname(os.path.abspath(__file__)), "..", "data", "niya.db"
-)
+from utils import DATA_DIR
+
+DB_PATH = os.path.join(DATA_DIR, "niya.db")
+SOLVED_BITMAP_PATH = os.path.join(DATA_DIR, "solved.bitmap")
 
 
 def init_db() -> None:
@@ -47,14 +51,164 @@ def init_db() -> None:
         )"""
     )
 
+    # Single-row resume point for --enumerate (see utils.enumerate_canonical)
+    c.execute(
+        """CREATE TABLE IF NOT EXISTS enumeration (
+            id INTEGER PRIMARY KEY CHECK (id = 0),
+            cursor BLOB NOT NULL
+        )"""
+    )
+
+    # How far each shard log has been imported (see shards.import_log)
+    c.execute(
+        """CREATE TABLE IF NOT EXISTS shard_imports (
+            path TEXT PRIMARY KEY,
+            offset INTEGER NOT NULL
+        )"""
+    )
+
+    # Rank-range work leases for campaign.py (coordinator side). A range is
+    # 'leased' until its results are imported, then 'done'; token is bumped
+    # on every reassignment so a superseded worker's heartbeats fail.
+    c.execute(
+        """CREATE TABLE IF NOT EXISTS leases (
+            start_rank INTEGER PRIMARY KEY,
+            end_rank INTEGER NOT NULL,
+            state TEXT NOT NULL,
+            worker TEXT,
+            token INTEGER NOT NULL,
+            expires REAL
+        )"""
+    )
+
+    _init_rollups(c)
+
     conn.commit()
     conn.close()
 
 
+# ---------------------------------------------------------------------------
+# Rollups: per-combination row counts of the columns analyze.py groups by,
+# kept exact by triggers on every insert (INSERT OR IGNORE duplicates do not
+# fire them), so aggregate queries read a few thousand rows instead of
+# scanning the raw tables. Weight by n: COUNT(*) becomes SUM(n).
+# ---------------------------------------------------------------------------
+
+_SOLUTION_ROLLUP_COLUMNS = (
+    "p1_win", "is_draw", "p1_best_move", "p1_outcome", "p1_best_move_pos", "game_depth",
+    "p1_wins_count", "p2_wins_count", "draws_count", "has_p2_data",
+)
+# p2_responses columns, plus board_p1_win: the board's overall P1 result
+_P2_ROLLUP_COLUMNS = ("board_p1_win", "p1_move", "p2_best_move", "is_p1_win", "outcome")
+
+
+def _init_rollups(c: sqlite3.Cursor) -> None:
+    """Create the rollup tables and triggers, backfilling a database that predates them."""
+    existing = {name for (name,) in c.execute("SELECT name FROM sqlite_master WHERE type = 'table'")}
+    sol_cols = ", ".join(_SOLUTION_ROLLUP_COLUMNS)
+    p2_cols = ", ".join(_P2_ROLLUP_COLUMNS)
+
+    c.execute(f"CREATE TABLE IF NOT EXISTS solution_counts ({sol_cols}, n INTEGER NOT NULL, "
+              f"PRIMARY KEY ({sol_cols}))")
+    c.execute(f"CREATE TABLE IF NOT EXISTS p2_counts ({p2_cols}, n INTEGER NOT NULL, "
+              f"PRIMARY KEY ({p2_cols}))")
+
+    new_sol = ", ".join(f"NEW.{col}" for col in _SOLUTION_ROLLUP_COLUMNS)
+    c.execute(
+        f"""CREATE TRIGGER IF NOT EXISTS solutions_rollup AFTER INSERT ON solutions BEGIN
+            INSERT INTO solution_counts VALUES ({new_sol}, 1)
+            ON CONFLICT ({sol_cols}) DO UPDATE SET n = n + 1;
+        END"""
+    )
+    c.execute(
+        f"""CREATE TRIGGER IF NOT EXISTS p2_responses_rollup AFTER INSERT ON p2_responses BEGIN
+            INSERT INTO p2_counts VALUES (
+                (SELECT p1_win FROM solutions WHERE perm_index = NEW.perm_index),
+                NEW.p1_move, NEW.p2_best_move, NEW.is_p1_win, NEW.outcome, 1)
+            ON CONFLICT ({p2_cols}) DO UPDATE SET n = n + 1;
+        END"""
+    )
+
+    # A database from before the rollups: one full scan, then the triggers take over
+    if "solution_counts" not in existing:
+        c.execute(f"INSERT INTO solution_counts SELECT {sol_cols}, COUNT(*) FROM solutions "
+                  f"GROUP BY {sol_cols}")
+    if "p2_counts" not in existing:
+        c.execute(
+            f"""INSERT INTO p2_counts
+                SELECT s.p1_win, r.p1_move, r.p2_best_move, r.is_p1_win, r.outcome, COUNT(*)
+                FROM p2_responses r LEFT JOIN solutions s ON s.perm_index = r.perm_index
+                GROUP BY s.p1_win, r.p1_move, r.p2_best_move, r.is_p1_win, r.outcome"""
+        )
+
+
+def get_enum_cursor() -> bytes | None:
+    """Get the saved enumeration cursor, or None if no campaign has started."""
+    conn = sqlite3.connect(DB_PATH)
+    row = conn.execute("SELECT cursor FROM enumeration WHERE id = 0").fetchone()
+    conn.close()
+    return bytes(row[0]) if row else None
+
+
+def get_import_offset(path: str) -> int:
+    """Byte offset up to which the shard log at `path` has been imported."""
+    conn = sqlite3.connect(DB_PATH)
+    row = conn.execute(
+        "SELECT offset FROM shard_imports WHERE path = ?", (os.path.abspath(path),)
+    ).fetchone()
+    conn.close()
+    return row[0] if row else 0
+
+
+def iter_solved_perm_indexes(chunk: int = 100_000):
+    """Yield the perm_index of every solved board."""
+    conn = sqlite3.connect(DB_PATH)
+    cur = conn.execute("SELECT perm_index FROM solutions")
+    while rows := cur.fetchmany(chunk):
+        for (perm_index,) in rows:
+            yield perm_index
+    conn.close()
+
+
+class SolvedSet:
+    """
+    Memory-mapped bitmap of solved classes, indexed by dense class rank
+    (utils.board_rank): one bit per class, ~290 MB for all of them.
+
+    The bitmap is a cache of the solutions table. `created` is True when
+    the file was just made, so the caller should fill it from the database;
+    bits are set after their batch is committed, so a crash can only leave
+    a solved board unmarked (it is then solved again and ignored).
+    """
+
+    def __init__(self, n_classes: int, path: str = SOLVED_BITMAP_PATH) -> None:
+        size = (n_classes + 7) // 8
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        self.created = not os.path.exists(path) or os.path.getsize(path) != size
+        with open(path, "a+b") as f:
+            if self.created:
+                f.truncate(0)
+                f.truncate(size)
+            self._map = mmap.mmap(f.fileno(), size)
+
+    def __contains__(self, rank: int) -> bool:
+        return bool(self._map[rank >> 3] & (1 << (rank & 7)))
+
+    def add(self, rank: int) -> None:
+        self._map[rank >> 3] |= 1 << (rank & 7)
+
+    def flush(self) -> None:
+        self._map.flush()
+
+    def close(self) -> None:
+        self._map.flush()
+        self._map.close()
+
+
 def get_solved_count() -> int:
-    """Get the number of boards already solved."""
+    """Get the number of boards already solved (from the rollup, not a table scan)."""
     conn = sqlite3.connect(DB_PATH)
-    count = conn.execute("SELECT COUNT(*) FROM solutions").fetchone()[0]
+    count = conn.execute("SELECT COALESCE(SUM(n), 0) FROM solution_counts").fetchone()[0]
     conn.close()
     return count
 
@@ -62,9 +216,13 @@ def get_solved_count() -> int:
 def save_batch(
     solutions: list[tuple],
     p2_responses: list[tuple],
+    enum_cursor: bytes | None = None,
+    import_progress: tuple[str, int] | None = None,
 ) -> None:
     """
     Save a batch of solver results. Duplicates are silently ignored.
+    If enum_cursor or import_progress is given it is stored in the same
+    transaction, so the saved position never runs ahead of the results.
 
     Args:
         solutions: list of (perm_index, p1_win, is_draw, p1_best_move,
@@ -72,10 +230,23 @@ def save_batch(
                             p1_wins_count, p2_wins_count, draws_count,
                             has_p2_data)
         p2_responses: list of (perm_index, p1_move, p2_best_move, is_p1_win, outcome)
+        enum_cursor: enumeration cursor after the last board in this batch
+        import_progress: (shard log path, byte offset after this batch)
     """
     conn = sqlite3.connect(DB_PATH)
-    c = conn.cursor()
+    _write_batch(conn.cursor(), solutions, p2_responses, enum_cursor, import_progress)
+    conn.commit()
+    conn.close()
 
+
+def _write_batch(
+    c: sqlite3.Cursor,
+    solutions: list[tuple],
+    p2_responses: list[tuple],
+    enum_cursor: bytes | None = None,
+    import_progress: tuple[str, int] | None = None,
+) -> None:
+    """Statements of save_batch, inside the caller's transaction."""
     c.executemany(
         "INSERT OR IGNORE INTO solutions VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
         solutions,
@@ -85,6 +256,171 @@ def save_batch(
             "INSERT OR IGNORE INTO p2_responses VALUES (?, ?, ?, ?, ?)",
             p2_responses,
         )
+    if enum_cursor is not None:
+        c.execute(
+            "INSERT OR REPLACE INTO enumeration (id, cursor) VALUES (0, ?)",
+            (enum_cursor,),
+        )
+    if import_progress is not None:
+        c.execute(
+            "INSERT OR REPLACE INTO shard_imports (path, offset) VALUES (?, ?)",
+            (os.path.abspath(import_progress[0]), import_progress[1]),
+        )
+
+
+class BatchWriter(threading.Thread):
+    """
+    Saves batches on a background thread so the solve loop never waits for
+    a commit. One connection stays open for the run, in WAL mode with
+    synchronous=NORMAL. Its statement cache keeps the INSERTs prepared.
+
+    put() blocks while `depth` batches are queued, which is the only
+    backpressure. Every batch already queued when the writer wakes goes
+    into one transaction, up to `max_rows` solutions, so a writer that
+    falls behind commits fewer, larger transactions. Ranks given with a
+    batch are added to `solved` after its commit.
+    """
+
+    def __init__(self, solved: SolvedSet | None = None, depth: int = 8,
+                 max_rows: int = 50_000) -> None:
+        super().__init__(name="db-writer", daemon=True)
+        self.solved = solved
+        self.max_rows = max_rows
+        self.queue: queue.Queue = queue.Queue(maxsize=depth)
+        self.error: BaseException | None = None
+        self.start()
+
+    def put(self, solutions: list[tuple], p2_responses: list[tuple],
+            enum_cursor: bytes | None = None, ranks: list[int] | None = None) -> None:
+        """Queue a batch (see save_batch). Re-raises a failure of the writer."""
+        if self.error is not None:
+            raise self.error
+        self.queue.put((solutions, p2_responses, enum_cursor, ranks or []))
+
+    def close(self) -> None:
+        """Commit everything queued and stop the thread."""
+        self.queue.put(None)
+        self.join()
+        if self.error is not None:
+            raise self.error
+
+    def run(self) -> None:
+        conn = sqlite3.connect(DB_PATH)
+        conn.execute("PRAGMA journal_mode=WAL")
+        conn.execute("PRAGMA synchronous=NORMAL")
+        c = conn.cursor()
+        stopping = False
+        try:
+            while not stopping:
+                batches = [self.queue.get()]
+                rows = len(batches[0][0]) if batches[0] else 0
+                while rows < self.max_rows:
+                    try:
+                        batches.append(self.queue.get_nowait())
+                    except queue.Empty:
+                        break
+                    rows += len(batches[-1][0]) if batches[-1] else 0
+                if None in batches:
+                    stopping = True
+                    batches = [b for b in batches if b is not None]
+
+                for solutions, p2_responses, enum_cursor, _ in batches:
+                    _write_batch(c, solutions, p2_responses, enum_cursor)
+                conn.commit()
+                if self.solved is not None:
+                    for _, _, _, ranks in batches:
+                        for rank in ranks:
+                            self.solved.add(rank)
+        except BaseException as err:
+            self.error = err
+            # Keep draining so producers blocked in put() can finish, unless
+            # the failed group already held close()'s sentinel
+            while not stopping and self.queue.get() is not None:
+                pass
+        finally:
+            conn.close()
+
+
+def claim_lease(worker: str, range_size: int, n_classes: int,
+                lease_seconds: float, now: float) -> tuple[int, int, int] | None:
+    """
+    Lease a rank range to `worker` until now + lease_seconds. Expired leases
+    are reassigned first (oldest range first), otherwise the next unleased
+    range is opened. Returns (start_rank, end_rank, token), or None if every
+    range is leased or done.
+    """
+    conn = sqlite3.connect(DB_PATH, isolation_level=None)
+    c = conn.cursor()
+    c.execute("BEGIN IMMEDIATE")
+
+    row = c.execute(
+        """SELECT start_rank, end_rank, token FROM leases
+           WHERE state = 'leased' AND expires < ?
+           ORDER BY start_rank LIMIT 1""",
+        (now,),
+    ).fetchone()
+    if row:
+        start, end, token = row[0], row[1], row[2] + 1
+        c.execute(
+            "UPDATE leases SET worker = ?, token = ?, expires = ? WHERE start_rank = ?",
+            (worker, token, now + lease_seconds, start),
+        )
+    else:
+        start = c.execute("SELECT COALESCE(MAX(end_rank), 0) FROM leases").fetchone()[0]
+        if start >= n_classes:
+            c.execute("COMMIT")
+            conn.close()
+            return None
+        end, token = min(start + range_size, n_classes), 0
+        c.execute(
+            "INSERT INTO leases VALUES (?, ?, 'leased', ?, ?, ?)",
+            (start, end, worker, token, now + lease_seconds),
+        )
+
+    c.execute("COMMIT")
+    conn.close()
+    return start, end, token
+
+
+def renew_lease(start_rank: int, token: int, lease_seconds: float, now: float) -> bool:
+    """Extend a lease. False if it was reassigned or is already done."""
+    conn = sqlite3.connect(DB_PATH)
+    cur = conn.execute(
+        """UPDATE leases SET expires = ?
+           WHERE start_rank = ? AND token = ? AND state = 'leased'""",
+        (now + lease_seconds, start_rank, token),
+    )
+    conn.commit()
+    conn.close()
+    return cur.rowcount == 1
+
+
+def get_lease(start_rank: int) -> tuple[int, str] | None:
+    """Return (end_rank, state) of the range starting at start_rank, if opened."""
+    conn = sqlite3.connect(DB_PATH)
+    row = conn.execute(
+        "SELECT end_rank, state FROM leases WHERE start_rank = ?", (start_rank,)
+    ).fetchone()
+    conn.close()
+    return row
 
+
+def complete_lease(start_rank: int) -> None:
+    """Mark a range done once its result shard is stored."""
+    conn = sqlite3.connect(DB_PATH)
+    conn.execute("UPDATE leases SET state = 'done' WHERE start_rank = ?", (start_rank,))
     conn.commit()
     conn.close()
+
+
+def get_lease_summary() -> tuple[int, int, int]:
+    """Return (ranks done, ranks leased, end of the last opened range)."""
+    conn = sqlite3.connect(DB_PATH)
+    done, leased, frontier = conn.execute(
+        """SELECT COALESCE(SUM(CASE WHEN state = 'done' THEN end_rank - start_rank END), 0),
+                  COALESCE(SUM(CASE WHEN state = 'leased' THEN end_rank - start_rank END), 0),
+                  COALESCE(MAX(end_rank), 0)
+           FROM leases"""
+    ).fetchone()
+    conn.close()
+    return done, leased, frontier
@@ -0,0 +1,181 @@
+"""
+Solved-board lookup by board code, without SQLite: the C library maps the
+opening book (see book.py) and answers each query with one
+canonicalization and a binary search, so startup is an mmap and a point
+query takes microseconds. Results are SolveResults for the board as given:
+the stored value, and the line, depth and moves of the stored game mapped
+back from its canonical form. That game is optimal, but where several
+moves are, it follows the canonical board's tie-break, so the moves,
+outcome and depth can differ from what solve_board picks for the board
+as given.
+
+The server answers batches of board codes as JSON, for the web client and
+debug tooling; it sends CORS headers so a page on another origin can ask.
+
+Usage:
+    python src/lookup.py 123456789 42           # Print stored results as JSON lines
+    python src/lookup.py --serve --port 8766    # GET /lookup?codes=1,2  or  POST /lookup {"codes": [...]}
+"""
+
+import argparse
+import ctypes
+import json
+import urllib.parse
+from http import HTTPStatus
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from book import BOOK_PATH
+from models import SolveResult
+from solver import _CSolveResult, _result_from_c
+from utils import _c_lib, get_permutation
+
+DEFAULT_PORT = 8766
+MAX_BATCH = 10_000      # board codes per request
+
+_TILES = [(p, s) for p in range(4) for s in range(4)]
+
+if _c_lib is not None:
+    _c_lib.book_open_c.argtypes = [ctypes.c_char_p]
+    _c_lib.book_open_c.restype = ctypes.c_uint64
+    _c_lib.book_lookup_c.argtypes = [
+        ctypes.c_char_p,                 # boards: n * (plants[16], poems[16])
+        ctypes.c_size_t,                 # n
+        ctypes.POINTER(_CSolveResult),   # out[n]
+    ]
+    _c_lib.book_lookup_c.restype = ctypes.c_size_t
+
+
+def open_book(path: str = BOOK_PATH) -> int:
+    """Map the book. Returns the number of boards in it, or 0 if it is missing or invalid."""
+    if _c_lib is None:
+        return 0
+    return _c_lib.book_open_c(path.encode())
+
+
+def lookup_boards(boards: list) -> list[SolveResult | None]:
+    """
+    Stored result of each board (any orientation or labeling), or None if
+    it is not solved or is not a permutation of the 16 tiles.
+    """
+    buf = bytearray(32 * len(boards))
+    for i, board in enumerate(boards):
+        if len(board) != 16:
+            continue  # All zeros: not a permutation either
+        for j, (plant, poem) in enumerate(board):
+            buf[32 * i + j] = plant if 0 <= plant < 4 else 0xFF
+            buf[32 * i + 16 + j] = poem if 0 <= poem < 4 else 0xFF
+    results = (_CSolveResult * max(len(boards), 1))()
+    _c_lib.book_lookup_c(bytes(buf), len(boards), results)
+    return [_result_from_c(r, skip_p2=r.p2_moves[0] < 0) if r.best_move >= 0 else None
+            for r in results[:len(boards)]]
+
+
+def lookup_codes(codes: list[int]) -> list[SolveResult | None]:
+    """lookup_boards for board codes (perm indexes); invalid codes give None."""
+    boards = [get_permutation(_TILES, code) if code >= 0 else None for code in codes]
+    found = iter(lookup_boards([b for b in boards if b is not None]))
+    return [next(found) if b is not None else None for b in boards]
+
+
+def result_json(code: int, result: SolveResult | None) -> dict:
+    """JSON form of one lookup."""
+    if result is None:
+        return {"code": code, "solved": False}
+    winner = "Draw" if result.is_draw else ("P1" if result.is_p1_win else "P2")
+    return {
+        "code": code,
+        "solved": True,
+        "winner": winner,
+        "outcome": result.outcome.value,
+        "best_move": result.best_move,
+        "game_depth": result.game_depth,
+        "p2_responses": [
+            {"p1_move": r.p1_move, "p2_best_move": r.p2_best_move,
+             "is_p1_win": r.is_p1_win, "outcome": r.outcome.value}
+            for r in result.p2_responses
+        ],
+    }
+
+
+class _Handler(BaseHTTPRequestHandler):
+    """GET /lookup?codes=1,2,3 or POST /lookup with {"codes": [...]}."""
+
+    def do_GET(self) -> None:
+        url = urllib.parse.urlsplit(self.path)
+        codes = urllib.parse.parse_qs(url.query).get("codes", [""])[0]
+        self._lookup(url.path, lambda: [int(c) for c in codes.split(",") if c])
+
+    def do_POST(self) -> None:
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        self._lookup(urllib.parse.urlsplit(self.path).path,
+                     lambda: [int(c) for c in json.loads(body)["codes"]])
+
+    def do_OPTIONS(self) -> None:
+        self._reply(HTTPStatus.NO_CONTENT)
+
+    def _lookup(self, path: str, parse_codes) -> None:
+        if path != "/lookup":
+            self._reply(HTTPStatus.NOT_FOUND)
+            return
+        try:
+            codes = parse_codes()
+        except (ValueError, KeyError, TypeError):
+            self._reply(HTTPStatus.BAD_REQUEST)
+            return
+        if len(codes) > MAX_BATCH:
+            self._reply(HTTPStatus.REQUEST_ENTITY_TOO_LARGE)
+            return
+        results = lookup_codes(codes)
+        self._reply(HTTPStatus.OK, {"results": [result_json(c, r) for c, r in zip(codes, results)]})
+
+    def _reply(self, status: HTTPStatus, payload: dict | None = None) -> None:
+        data = json.dumps(payload).encode() if payload is not None else b""
+        self.send_response(status)
+        self.send_header("Access-Control-Allow-Origin", "*")
+        self.send_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS")
+        self.send_header("Access-Control-Allow-Headers", "Content-Type")
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, format: str, *args) -> None:
+        pass
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Look up solved boards by board code.")
+    parser.add_argument("codes", nargs="*", type=int, help="Board codes to look up.")
+    parser.add_argument("--book", default=BOOK_PATH,
+                        help="Opening book to serve (default: web/public/opening_book.bin).")
+    parser.add_argument("--serve", action="store_true", help="Answer lookups over HTTP.")
+    parser.add_argument("--host", default="127.0.0.1",
+                        help="Address to listen on (default: 127.0.0.1).")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT,
+                        help=f"Port to listen on (default: {DEFAULT_PORT}).")
+    args = parser.parse_args()
+
+    if _c_lib is None:
+        raise SystemExit("[!] Lookups need src/solver_core.so")
+    n = open_book(args.book)
+    if not n:
+        raise SystemExit(f"[!] No opening book at {args.book}: run `python src/book.py` first")
+
+    if not args.serve:
+        for code, result in zip(args.codes, lookup_codes(args.codes)):
+            print(json.dumps(result_json(code, result)))
+        return
+
+    print(f"[*] {n:,} solved boards from {args.book}")
+    print(f"[*] Listening on {args.host}:{args.port} (Ctrl+C to stop)")
+    server = ThreadingHTTPServer((args.host, args.port), _Handler)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\n[*] Stopped.")
+    finally:
+        server.server_close()
+
+
+if __name__ == "__main__":
+    main()
@@ -9,52 +9,94 @@ treated as identical. This reduces the search space from 16! (~20.9T) to
 Usage:
     python src/main.py              # Solve with P2 analysis (slower, full data)
     python src/main.py --skip-p2    # Solve P1 only (faster, no P2 data)
-    python src/main.py --workers 8  # Use 8 parallel workers
+    python src/main.py --workers 8  # Use 8 parallel workers (native threads)
+    python src/main.py --tt-mb 64   # 64 MB transposition table per worker
+    python src/main.py --enumerate  # Solve every canonical board once, in order (resumable)
+    python src/main.py --build-rank-table  # One-off: enables the solved-set bitmap
 """
 
 import argparse
+import itertools
+import json
 import math
+import multiprocessing
 import os
 import random
 import signal
 import time
-from concurrent.futures import ProcessPoolExecutor, as_completed
+from array import array
+from concurrent.futures import FIRST_COMPLETED, ProcessPoolExecutor, wait
+from dataclasses import asdict
+from functools import partial
 
 from tqdm import tqdm
-from utils import canonicalize_board, board_to_perm_index
-from database import init_db, get_solved_count, save_batch
-from solver import solve_board
-from models import Outcome, Tile
+from utils import (ENUM_START, board_rank, build_rank_table, canonicalize_boards,
+                   enumerate_canonical, load_rank_table, perm_index_boards, perm_indexes_of,
+                   unpack_boards)
+from database import (BatchWriter, SolvedSet, init_db, get_enum_cursor, get_solved_count,
+                      iter_solved_perm_indexes)
+from solver import (DEFAULT_POSITION_CACHE_MB, DEFAULT_TT_MB, check_tt_mb,
+                    configure_position_cache, configure_tt, cpu_sets, has_native_batch,
+                    has_tracing, pin_threads, read_stats, solve_board, solve_boards,
+                    solve_boards_traced, table_memory, table_pages)
+from models import Outcome, SolveResult, SolverStats, Tile
 
 # Constants
 TILES: list[Tile] = [(p, s) for p in range(4) for s in range(4)]  # 16 tiles
+N_PERMS = math.factorial(16)
 
 
-def _worker_init() -> None:
+def _worker_init(pin_sets: list[set[int]] | None = None, counter=None) -> None:
     """
     Initialize worker process:
     1. Ignore SIGINT so only the main process handles Ctrl+C.
     2. Re-seed random to avoid duplicate sequences.
+    3. With --pin, move onto the next CPU set (round-robin over workers).
     """
     signal.signal(signal.SIGINT, signal.SIG_IGN)
     random.seed(os.getpid() ^ int(time.monotonic_ns()))
+    if pin_sets:
+        with counter.get_lock():
+            index = counter.value
+            counter.value += 1
+        os.sched_setaffinity(0, pin_sets[index % len(pin_sets)])
+
+
+def sample_canonical_batch(n: int) -> tuple[bytearray, array, array]:
+    """
+    Draw `n` uniformly random boards (as random perm indexes) and
+    canonicalize them with one C call. Returns the canonical boards as a
+    buffer (see utils.canonicalize_boards), their perm indexes and their
+    dense class ranks (-1 without a rank table).
+    """
+    raw = perm_index_boards([random.randrange(N_PERMS) for _ in range(n)])
+    return canonicalize_boards(raw)
+
+
+def sample_canonical() -> tuple[int, list[Tile]]:
+    """
+    Generate a random board and canonicalize it.
+    Returns (perm_index, canonical_board). Every sample is a solvable
+    canonical board (no wasted samples).
+    """
+    canonical, perm_indexes, _ = sample_canonical_batch(1)
+    return perm_indexes[0], unpack_boards(canonical)[0]
 
 
 def solve_one(skip_p2: bool) -> tuple[list[tuple], list[tuple]]:
     """
-    Generate a random board, canonicalize it, and solve.
+    Sample and solve one board (process-pool path).
     Returns (solution_rows, p2_rows).
-    Every call produces a solvable canonical board (no wasted samples).
     """
-    # Generate random board and canonicalize
-    board = list(TILES)
-    random.shuffle(board)
-    canonical = canonicalize_board(board)
-    perm_index = board_to_perm_index(canonical)
+    perm_index, canonical = sample_canonical()
 
     # Solve (skip_canonical=True since we already canonicalized)
-    result = solve_board(list(canonical), skip_canonical=True, skip_p2=skip_p2)
+    result = solve_board(canonical, skip_canonical=True, skip_p2=skip_p2)
+    return result_rows(perm_index, result, skip_p2)
+
 
+def result_rows(perm_index: int, result: SolveResult, skip_p2: bool) -> tuple[list[tuple], list[tuple]]:
+    """Build the (solution_rows, p2_rows) database rows for one solved board."""
     has_p2 = not skip_p2 and len(result.p2_responses) > 0
 
     solution_row = [(
@@ -85,6 +127,140 @@ def solve_one(skip_p2: bool) -> tuple[list[tuple], list[tuple]]:
     return solution_row, p2_rows
 
 
+def solve_samples(samples: list[tuple[int, list[Tile]]], skip_p2: bool,
+                  threads: int, trace=None) -> list[tuple[list[tuple], list[tuple]]]:
+    """
+    Solve (perm_index, canonical_board) samples across `threads` native
+    threads with a single call into the C batch solver. With a `trace`
+    file (needs a -DNIYA_TRACE build), each board's search trace is
+    appended to it as a JSON line (see trace_line).
+    """
+    boards = [board for _, board in samples]
+    if trace is None:
+        results = solve_boards(boards, skip_p2=skip_p2, threads=threads)
+    else:
+        results, traces = solve_boards_traced(boards, skip_p2=skip_p2, threads=threads)
+        trace.writelines(trace_line(perm_index, result, board_trace)
+                         for (perm_index, _), result, board_trace in zip(samples, results, traces))
+        trace.flush()
+    return [result_rows(perm_index, result, skip_p2)
+            for (perm_index, _), result in zip(samples, results)]
+
+
+def trace_line(perm_index: int, result: SolveResult, trace) -> str:
+    """One --trace record: the board, its result and its BoardTrace fields."""
+    winner = "Draw" if result.is_draw else ("P1" if result.is_p1_win else "P2")
+    return json.dumps({
+        "perm_index": perm_index, "winner": winner, "outcome": result.outcome.value,
+        "best_move": result.best_move, "game_depth": result.game_depth,
+        "p1_wins_count": result.p1_wins_count, **asdict(trace),
+    }) + "\n"
+
+
+def native_batch(skip_p2: bool, threads: int, solved: SolvedSet | None, trace,
+                 size: int) -> tuple[list[tuple[list[tuple], list[tuple]]], list[int]]:
+    """
+    Sample `size` boards here and solve them with the C batch solver.
+    With a solved-set bitmap, classes that are already solved (or already
+    in this batch) are resampled. Returns (rows, ranks of the new classes).
+    """
+    samples = []
+    ranks: set[int] = set()
+    while len(samples) < size:
+        canonical, perm_indexes, class_ranks = sample_canonical_batch(size - len(samples))
+        rows = []
+        for b, rank in enumerate(class_ranks):
+            if solved is not None:
+                if rank in solved or rank in ranks:
+                    continue
+                ranks.add(rank)
+            rows.append(b)
+        samples.extend(zip((perm_indexes[b] for b in rows), unpack_boards(canonical, rows)))
+    return solve_samples(samples, skip_p2, threads, trace), list(ranks)
+
+
+class Enumeration:
+    """
+    Walks every canonical board exactly once, in lexicographic order. The
+    cursor is saved with each batch, so a stopped campaign resumes after
+    the last board whose results reached the database.
+    """
+
+    def __init__(self, skip_p2: bool, threads: int, solved: SolvedSet | None,
+                 trace=None) -> None:
+        self.skip_p2 = skip_p2
+        self.threads = threads
+        self.solved = solved
+        self.trace = trace
+        self.cursor = get_enum_cursor() or ENUM_START
+        self.done = False
+
+    def next_batch(self, size: int) -> tuple[list[tuple[list[tuple], list[tuple]]], list[int]]:
+        boards, self.cursor = enumerate_canonical(self.cursor, size)
+        self.done = len(boards) < size
+        samples = list(zip(perm_indexes_of(boards), boards))
+        ranks = []
+        if self.solved is not None and boards:
+            # Skip classes already solved by earlier sampling runs; boards
+            # come out in rank order, so only the first needs a lookup
+            first = board_rank(boards[0])
+            kept = [i for i in range(len(boards)) if first + i not in self.solved]
+            samples = [samples[i] for i in kept]
+            ranks = [first + i for i in kept]
+        return solve_samples(samples, self.skip_p2, self.threads, self.trace), ranks
+
+
+class PoolStream:
+    """
+    Keeps `window` one-board tasks in flight on a process pool, topping the
+    window up as each finishes, so workers never idle at a batch boundary.
+    At most `limit` boards are submitted in total (None = no limit).
+    """
+
+    def __init__(self, pool: ProcessPoolExecutor, skip_p2: bool, window: int,
+                 limit: int | None) -> None:
+        self.pool = pool
+        self.skip_p2 = skip_p2
+        self.window = window
+        self.budget = limit
+        self.pending: set = set()
+
+    def _fill(self) -> None:
+        while len(self.pending) < self.window and self.budget != 0:
+            self.pending.add(self.pool.submit(solve_one, self.skip_p2))
+            if self.budget is not None:
+                self.budget -= 1
+
+    def next_batch(self, size: int) -> tuple[list[tuple[list[tuple], list[tuple]]], list[int]]:
+        """The next `size` (or a few more) finished boards; no bitmap ranks."""
+        results = []
+        self._fill()
+        while len(results) < size and self.pending:
+            done, self.pending = wait(self.pending, return_when=FIRST_COMPLETED)
+            results.extend(future.result() for future in done)
+            self._fill()
+        return results, []
+
+
+def open_solved_set() -> SolvedSet | None:
+    """
+    Map the solved-set bitmap if a rank table exists, filling a freshly
+    created bitmap from the boards already in the database.
+    """
+    n_classes = load_rank_table()
+    if not n_classes:
+        return None
+    solved = SolvedSet(n_classes)
+    if solved.created:
+        # Re-rank the stored boards 64k at a time, one C call per chunk
+        perm_indexes = iter_solved_perm_indexes()
+        while chunk := list(itertools.islice(perm_indexes, 65536)):
+            for rank in canonicalize_boards(perm_index_boards(chunk))[2]:
+                solved.add(rank)
+        solved.flush()
+    return solved
+
+
 def format_eta(seconds: float) -> str:
     """Format seconds into a human-readable days/hours/minutes string."""
     if seconds <= 0 or not math.isfinite(seconds):
@@ -101,6 +277,20 @@ def format_eta(seconds: float) -> str:
     return " ".join(parts)
 
 
+def format_stats(stats: SolverStats, seconds: float) -> str:
+    """One-line live search rates for the progress bar."""
+    solve_time = stats.phase1_seconds + stats.phase2_seconds
+    p2_share = stats.phase2_seconds / solve_time if solve_time else 0.0
+    evictions = stats.tt_evictions / stats.tt_stores if stats.tt_stores else 0.0
+    shared = f"shared hit {stats.pc_hit_rate:.0%}, " if stats.pc_probes else ""
+    return (f"{stats.nodes / max(seconds, 1e-9) / 1e6:.2f}M nodes/s, "
+            f"{stats.nodes / max(stats.boards, 1):,.0f} nodes/board, "
+            f"endgame {stats.endgame_nodes / max(stats.nodes, 1):.0%}, "
+            f"TT hit {stats.tt_hit_rate:.0%} evict {evictions:.0%}, {shared}"
+            f"1st-child cut {stats.first_child_cutoff_rate:.0%}, "
+            f"depth {stats.max_depth}, P2 {p2_share:.0%} of time")
+
+
 def main() -> None:
     parser = argparse.ArgumentParser(description="Niya batch solver.")
     parser.add_argument(
@@ -111,14 +301,16 @@ def main() -> None:
     parser.add_argument(
         "--batch-size",
         type=int,
-        default=10,
-        help="Number of boards to solve per DB save (default: 10).",
+        default=None,
+        help="Number of boards to solve per DB save (default: 64 per worker "
+             "with the C batch solver, else 10).",
     )
     parser.add_argument(
         "--workers",
         type=int,
         default=os.cpu_count(),
-        help="Number of parallel worker processes (default: CPU count).",
+        help="Number of parallel workers: native threads with the C batch "
+             "solver, else processes (default: CPU count).",
     )
     parser.add_argument(
         "--target",
@@ -126,68 +318,203 @@ def main() -> None:
         default=None,
         help="Target number of boards to solve (enables ETA display).",
     )
+    parser.add_argument(
+        "--enumerate",
+        action="store_true",
+        help="Solve every canonical board exactly once, in order, resuming "
+             "from the cursor saved in the database (needs the C solver).",
+    )
+    parser.add_argument(
+        "--build-rank-table",
+        action="store_true",
+        help="Build data/rank_table.bin (dense class ranks, ~10 CPU-minutes) "
+             "and exit. With it, runs skip classes that are already solved.",
+    )
+    parser.add_argument(
+        "--tt-mb",
+        type=int,
+        default=DEFAULT_TT_MB,
+        help=f"Transposition table size per worker in MB (default: {DEFAULT_TT_MB}).",
+    )
+    parser.add_argument(
+        "--position-cache",
+        type=int,
+        default=0,
+        metavar="DEPTH",
+        help="Share the results of positions with DEPTH tiles down (8-15) across "
+             "boards, in one table per process (default: off).",
+    )
+    parser.add_argument(
+        "--position-cache-mb",
+        type=int,
+        default=DEFAULT_POSITION_CACHE_MB,
+        help=f"Shared position cache size in MB (default: {DEFAULT_POSITION_CACHE_MB}).",
+    )
+    parser.add_argument(
+        "--pin",
+        choices=("core", "node"),
+        default=None,
+        help="Pin workers round-robin to CPU cores or NUMA nodes, so each "
+             "worker's tables stay in local memory (Linux; default: off).",
+    )
+    parser.add_argument(
+        "--trace",
+        default=None,
+        metavar="PATH",
+        help="Append each board's search trace (nodes, time, per-depth node and "
+             "TT-hit counts) to PATH as JSON lines; needs a -DNIYA_TRACE build. "
+             "Rank them with trace_report.py.",
+    )
     args = parser.parse_args()
 
+    check_tt_mb(args.tt_mb, args.workers)
+    # Workers inherit the env var (spawn) or the configured library (fork)
+    os.environ["NIYA_TT_MB"] = str(args.tt_mb)
+    tt_mb = configure_tt(args.tt_mb)
+    position_cache_mb = 0
+    if args.position_cache:
+        os.environ["NIYA_POSITION_CACHE"] = f"{args.position_cache}:{args.position_cache_mb}"
+        position_cache_mb = configure_position_cache(args.position_cache, args.position_cache_mb)
+
+    native = has_native_batch()
+    pin_sets = cpu_sets(args.pin) if args.pin else None
+    if pin_sets and native and not pin_threads(pin_sets):
+        parser.error("--pin is only supported on Linux")
+    if (args.enumerate or args.build_rank_table) and not native:
+        parser.error("--enumerate and --build-rank-table need the C solver (src/solver_core.so)")
+    if args.trace and not (native and has_tracing()):
+        parser.error("--trace needs src/solver_core.so built with -DNIYA_TRACE")
+
+    if args.build_rank_table:
+        print(f"[*] Building rank table with {args.workers} threads...")
+        t0 = time.monotonic()
+        n_classes = build_rank_table(threads=args.workers)
+        if not n_classes:
+            raise SystemExit("[!] Failed to write the rank table")
+        print(f"[*] {n_classes:,} classes ranked in {format_eta(time.monotonic() - t0)}")
+        return
+    batch_size = args.batch_size or (64 * args.workers if native else 10)
+
     init_db()
     solved_count = get_solved_count()
+    solved = open_solved_set() if native else None
 
     mode = "P1 only (fast)" if args.skip_p2 else "P1 + P2 analysis"
     print(f"[*] Niya Solver - {mode}")
-    print(f"[*] Workers: {args.workers}")
+    print(f"[*] Workers: {args.workers} ({'native threads' if native else 'processes'})")
+    if tt_mb:
+        # Mapping this thread's table settles the size, if less than asked fits
+        pages = table_pages()
+        tt_mb = table_memory()[1] >> 20
+        print(f"[*] Transposition table: {tt_mb} MB per worker")
+        if pages:
+            print(f"[*] Table memory: {pages}")
+    if pin_sets:
+        unit = "cores" if args.pin == "core" else "NUMA nodes"
+        print(f"[*] Pinning workers to {len(pin_sets)} {unit}")
+    if position_cache_mb:
+        scope = "shared by all threads" if native else "per worker process"
+        print(f"[*] Position cache: depth {args.position_cache}, {position_cache_mb} MB {scope}")
     if args.target:
         print(f"[*] Target: {args.target:,} boards")
+    if solved is not None:
+        print("[*] Solved-set bitmap: skipping classes that are already solved")
+    if args.trace:
+        print(f"[*] Tracing: per-board search traces appended to {args.trace}")
     if solved_count:
         print(f"[*] Resuming with {solved_count:,} boards from previous runs")
-    print(f"[*] Sampling random boards... (Ctrl+C to stop)\n")
+    if args.enumerate:
+        print(f"[*] Enumerating canonical boards in order... (Ctrl+C to stop)\n")
+    else:
+        print(f"[*] Sampling random boards... (Ctrl+C to stop)\n")
 
     total = (solved_count + args.target) if args.target else None
     pbar = tqdm(initial=solved_count, total=total, unit=" boards", desc="Solved")
     start_time = time.monotonic()
     new_solved = 0
+    pool = None
+    enumeration = None
+    # Commits run on this thread, overlapping the next batch's solving
+    writer = BatchWriter(solved)
+    trace = open(args.trace, "a") if args.trace else None
+    read_stats()    # start the counters from this run
+    stats_time = start_time
 
     try:
-        with ProcessPoolExecutor(
-            max_workers=args.workers,
-            initializer=_worker_init,
-        ) as pool:
-            while True:
-                # Submit a batch of work to the pool
-                futures = {
-                    pool.submit(solve_one, args.skip_p2)
-                    for _ in range(args.batch_size)
-                }
-
-                # Collect results as they complete
-                batch_solutions: list[tuple] = []
-                batch_p2: list[tuple] = []
-
-                for future in as_completed(futures):
-                    sol_rows, p2_rows = future.result()
-                    if sol_rows:
-                        batch_solutions.extend(sol_rows)
-                        batch_p2.extend(p2_rows)
-                        new_solved += 1
-                        pbar.update(1)
-
-                # Update ETA in postfix
-                elapsed = time.monotonic() - start_time
-                if new_solved > 0 and args.target:
-                    rate = new_solved / elapsed
-                    remaining = args.target - new_solved
-                    eta_secs = remaining / rate
-                    pbar.set_postfix_str(f"ETA: {format_eta(eta_secs)}")
-
-                # Save the batch
-                if batch_solutions:
-                    save_batch(batch_solutions, batch_p2)
-
-                # Stop if target reached
-                if args.target and new_solved >= args.target:
-                    break
+        if args.enumerate:
+            enumeration = Enumeration(args.skip_p2, args.workers, solved, trace)
+            next_batch = enumeration.next_batch
+        elif native:
+            next_batch = partial(native_batch, args.skip_p2, args.workers, solved, trace)
+        else:
+            pool = ProcessPoolExecutor(max_workers=args.workers, initializer=_worker_init,
+                                       initargs=(pin_sets, multiprocessing.Value("i", 0)))
+            next_batch = PoolStream(pool, args.skip_p2, 4 * args.workers, args.target).next_batch
+
+        while True:
+            size = batch_size
+            if args.target:
+                size = min(size, args.target - new_solved)
+            batch, batch_ranks = next_batch(size)
+
+            batch_solutions: list[tuple] = []
+            batch_p2: list[tuple] = []
+
+            for sol_rows, p2_rows in batch:
+                if sol_rows:
+                    batch_solutions.extend(sol_rows)
+                    batch_p2.extend(p2_rows)
+                    new_solved += 1
+            pbar.update(len(batch_solutions))
+
+            # Update ETA and (stats builds only) search rates in postfix
+            now = time.monotonic()
+            elapsed = now - start_time
+            postfix = []
+            if new_solved > 0 and args.target:
+                rate = new_solved / elapsed
+                remaining = args.target - new_solved
+                eta_secs = remaining / rate
+                postfix.append(f"ETA: {format_eta(eta_secs)}")
+            stats = read_stats()
+            if stats is not None and stats.boards:
+                postfix.append(format_stats(stats, now - stats_time))
+                stats_time = now
+            if postfix:
+                pbar.set_postfix_str(" | ".join(postfix))
+
+            # Queue the batch for the writer (an enumeration batch may be
+            # all skips, but its cursor still has to advance)
+            if batch_solutions or enumeration:
+                writer.put(batch_solutions, batch_p2,
+                           enumeration.cursor if enumeration else None, batch_ranks)
+
+            # Stop if target reached
+            if args.target and new_solved >= args.target:
+                break
+            if enumeration and enumeration.done:
+                pbar.close()
+                print("\n[*] Enumeration complete: every canonical board is solved.")
+                break
+
+        if pool is not None:
+            pool.shutdown()
+        writer.close()
+        if solved is not None:
+            solved.close()
+        if trace is not None:
+            trace.close()
 
     except KeyboardInterrupt:
-        # Shut down pool without noisy worker tracebacks
-        pool.shutdown(wait=False, cancel_futures=True)
+        # Shut down pool without noisy worker tracebacks. The native solver
+        # finishes its current batch before Python sees the interrupt.
+        if pool is not None:
+            pool.shutdown(wait=False, cancel_futures=True)
+        writer.close()
+        if solved is not None:
+            solved.close()
+        if trace is not None:
+            trace.close()
         pbar.close()
         print(f"\n[*] Stopped. Total boards solved: {get_solved_count():,}")
 
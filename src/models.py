@@ -88,3 +88,57 @@ class SolveResult:
             best_move_position="", p1_wins_count=0,
             p2_wins_count=0, draws_count=0, p2_responses=[],
         )
+
+
+@dataclass
+class SolverStats:
+    """
+    Search counters from the C solver, summed over every board solved since
+    the last read (see solver.read_stats). Only available when
+    solver_core.so is built with -DNIYA_STATS.
+    """
+    boards: int                  # Boards solved
+    nodes: int                   # Minimax nodes visited
+    endgame_nodes: int           # ... of them in the endgame kernel (no TT)
+    tt_probes: int               # Transposition table lookups
+    tt_hits: int                 # ... that found the position
+    tt_stores: int
+    tt_evictions: int            # Stores that replaced another position
+    pc_probes: int               # Shared position cache lookups
+    pc_hits: int                 # ... that found the position
+    cutoffs: int                 # Beta cutoffs
+    first_child_cutoffs: int     # ... on the first child searched
+    max_depth: int               # Most tiles placed at any node
+    phase1_seconds: float        # Best opening and its line
+    phase2_seconds: float        # P2 analysis
+
+    @property
+    def tt_hit_rate(self) -> float:
+        return self.tt_hits / self.tt_probes if self.tt_probes else 0.0
+
+    @property
+    def pc_hit_rate(self) -> float:
+        return self.pc_hits / self.pc_probes if self.pc_probes else 0.0
+
+    @property
+    def first_child_cutoff_rate(self) -> float:
+        """Share of cutoffs found on the first move tried (move-ordering quality)."""
+        return self.first_child_cutoffs / self.cutoffs if self.cutoffs else 0.0
+
+
+@dataclass
+class BoardTrace:
+    """
+    Where the C search of one board went (see solver.solve_boards_traced).
+    Only available when solver_core.so is built with -DNIYA_TRACE. Lists
+    are indexed by tiles placed (depth) or by legal reply count, 0-16.
+    """
+    nodes: int                   # Search nodes (minimax, endgame and df-pn)
+    seconds: float               # Solve time
+    phase2_nodes: int            # ... of the nodes, in P2 analysis
+    p2_fail_nodes: int           # Under P2 replies that did not cut off
+    p2_late_nodes: int           # ... at nodes a later P2 reply cut off (move-ordering cost)
+    depth_nodes: list[int]       # Nodes by depth
+    depth_tt_probes: list[int]   # TT probes by depth (none in the endgame kernel)
+    depth_tt_hits: list[int]     # ... that found the position
+    reply_nodes: list[int]       # Nodes that generated moves, by number of legal replies
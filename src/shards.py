@@ -0,0 +1,290 @@
+"""
+Binary result shards: fixed-width packed records keyed by dense class rank
+(utils.board_rank), 2 bytes per board for P1 results and 14 with P2 data.
+
+A shard log is an append-only file of shards back to back; each shard is
+self-describing and checksummed, so a log can be verified, concatenated
+or truncated at any shard boundary. Shards bridge to the SQLite schema in
+both directions, so analyze.py keeps working on imported results.
+
+Shard layout (little-endian):
+    magic        8s   b"NIYASHD1"
+    version      u16  SHARD_VERSION
+    record_size  u16  2, or 14 with SHARD_P2
+    flags        u32  SHARD_P2 | SHARD_RANKED
+    start_rank   u64  rank of the first record (dense shards)
+    count        u32  number of records
+    crc32        u32  over the header (with this field zeroed) and body
+    body         count records; with SHARD_RANKED each is preceded by its
+                 u32 rank (sparse shards), otherwise record i has rank
+                 start_rank + i
+
+Record:
+    u16  best_move:4 | outcome:3 | winner:2 | game_depth:5 | has_p2:1
+    12x  u8 per opening in OPENING_INDICES order (SHARD_P2 only):
+         p2_best_move:4 | outcome:3 | is_p1_win:1
+
+Outcome is the OUTCOME_TABLE index, winner is 0 = P1, 1 = P2, 2 = draw.
+The P2 summary counts and the best-move position are derived, not stored.
+
+Usage:
+    python src/shards.py info data/results.shards     # Verify and summarize a log
+    python src/shards.py import data/results.shards   # Load new shards into niya.db
+    python src/shards.py export out.shards            # niya.db -> sparse shards
+"""
+
+import argparse
+import os
+import sqlite3
+import struct
+import zlib
+from dataclasses import dataclass
+
+from database import DB_PATH, get_import_offset, init_db, save_batch
+from models import classify_position
+from solver import OPENING_INDICES, OUTCOME_TABLE
+from utils import (DATA_DIR, board_unrank, canonicalize_boards, cursor_at_rank,
+                   enumerate_canonical, load_rank_table, perm_index_boards, perm_indexes_of)
+
+SHARD_MAGIC = b"NIYASHD1"
+SHARD_VERSION = 1
+SHARD_P2 = 1        # records carry the 12 P2 responses
+SHARD_RANKED = 2    # each record is preceded by its u32 rank
+
+SHARD_LOG_PATH = os.path.join(DATA_DIR, "results.shards")
+
+_HEADER = struct.Struct("<8sHHIQII")
+P1_RECORD_SIZE = 2
+P2_RECORD_SIZE = P1_RECORD_SIZE + len(OPENING_INDICES)
+
+_OUTCOME_INDEX = {outcome.value: i for i, outcome in enumerate(OUTCOME_TABLE)}
+_DRAW = "Draw"
+
+
+class ShardError(ValueError):
+    """A shard is truncated, has a bad header, or fails its checksum."""
+
+
+@dataclass
+class Shard:
+    """One decoded shard: its header fields and raw record bytes."""
+    flags: int
+    start_rank: int
+    count: int
+    body: bytes
+
+    @property
+    def has_p2(self) -> bool:
+        return bool(self.flags & SHARD_P2)
+
+    def ranks(self) -> list[int]:
+        """Rank of each record, in order."""
+        if not self.flags & SHARD_RANKED:
+            return list(range(self.start_rank, self.start_rank + self.count))
+        stride = 4 + _record_size(self.flags)
+        return [struct.unpack_from("<I", self.body, i * stride)[0] for i in range(self.count)]
+
+    def rows(self, perm_indexes: list[int]) -> tuple[list[tuple], list[tuple]]:
+        """
+        Database rows (see database.save_batch) for the records, given the
+        perm_index of each record's board.
+        """
+        size = _record_size(self.flags)
+        stride = size + (4 if self.flags & SHARD_RANKED else 0)
+        skip = stride - size
+        solutions: list[tuple] = []
+        p2_rows: list[tuple] = []
+        for i, perm_index in enumerate(perm_indexes):
+            base = i * stride + skip
+            sol, p2 = _unpack_record(self.body[base:base + size], perm_index)
+            solutions.append(sol)
+            p2_rows.extend(p2)
+        return solutions, p2_rows
+
+
+def _record_size(flags: int) -> int:
+    return P2_RECORD_SIZE if flags & SHARD_P2 else P1_RECORD_SIZE
+
+
+def _pack_record(solution: tuple, p2_rows: list[tuple], with_p2: bool) -> bytes:
+    """Pack one board's solution row and P2 rows (save_batch layout)."""
+    _, p1_win, is_draw, best_move, outcome, _, depth, _, _, _, has_p2 = solution
+    winner = 2 if is_draw else (0 if p1_win else 1)
+    has_p2 = bool(has_p2) and with_p2
+    word = (best_move | _OUTCOME_INDEX[outcome] << 4 | winner << 7
+            | depth << 9 | has_p2 << 14)
+    record = struct.pack("<H", word)
+    if with_p2:
+        p2 = bytearray(len(OPENING_INDICES))
+        if has_p2:
+            for _, p1_move, p2_best, is_p1_win, p2_outcome in p2_rows:
+                p2[OPENING_INDICES.index(p1_move)] = (
+                    p2_best | _OUTCOME_INDEX[p2_outcome] << 4 | bool(is_p1_win) << 7)
+        record += bytes(p2)
+    return record
+
+
+def _unpack_record(record: bytes, perm_index: int) -> tuple[tuple, list[tuple]]:
+    """Inverse of _pack_record."""
+    word = record[0] | record[1] << 8
+    best_move = word & 0xF
+    outcome = OUTCOME_TABLE[word >> 4 & 7].value
+    winner = word >> 7 & 3
+    has_p2 = bool(word >> 14 & 1)
+
+    p2_rows: list[tuple] = []
+    p1_wins = draws = 0
+    if has_p2:
+        for p1_move, byte in zip(OPENING_INDICES, record[P1_RECORD_SIZE:]):
+            p2_outcome = OUTCOME_TABLE[byte >> 4 & 7].value
+            is_p1_win = bool(byte >> 7)
+            p1_wins += is_p1_win
+            draws += p2_outcome == _DRAW
+            p2_rows.append((perm_index, p1_move, byte & 0xF, is_p1_win, p2_outcome))
+    p2_wins = len(p2_rows) - p1_wins - draws
+
+    solution = (perm_index, winner == 0, winner == 2, best_move, outcome,
+                classify_position(best_move), word >> 9 & 0x1F,
+                p1_wins, p2_wins, draws, has_p2)
+    return solution, p2_rows
+
+
+def encode_shard(rows: list[tuple[list[tuple], list[tuple]]], with_p2: bool,
+                 start_rank: int = 0, ranks: list[int] | None = None) -> bytes:
+    """
+    Pack per-board (solution_rows, p2_rows), as built by main.result_rows,
+    into one shard. Dense shards cover ranks [start_rank, start_rank +
+    len(rows)); pass `ranks` to write a sparse shard instead.
+    """
+    flags = (SHARD_P2 if with_p2 else 0) | (SHARD_RANKED if ranks is not None else 0)
+    body = bytearray()
+    for i, (solution_rows, p2_rows) in enumerate(rows):
+        if ranks is not None:
+            body += struct.pack("<I", ranks[i])
+        body += _pack_record(solution_rows[0], p2_rows, with_p2)
+
+    header = _HEADER.pack(SHARD_MAGIC, SHARD_VERSION, _record_size(flags), flags,
+                          start_rank, len(rows), 0)
+    crc = zlib.crc32(body, zlib.crc32(header))
+    return header[:-4] + struct.pack("<I", crc) + bytes(body)
+
+
+def decode_shard(data: bytes, offset: int = 0) -> tuple[Shard, int]:
+    """Decode the shard at `offset`. Returns (shard, offset just past it)."""
+    if len(data) - offset < _HEADER.size:
+        raise ShardError(f"truncated shard header at byte {offset}")
+    magic, version, record_size, flags, start_rank, count, crc = _HEADER.unpack_from(data, offset)
+    if magic != SHARD_MAGIC or version != SHARD_VERSION or record_size != _record_size(flags):
+        raise ShardError(f"bad shard header at byte {offset}")
+
+    stride = record_size + (4 if flags & SHARD_RANKED else 0)
+    begin = offset + _HEADER.size
+    end = begin + count * stride
+    if end > len(data):
+        raise ShardError(f"truncated shard body at byte {offset}")
+    header = bytearray(data[offset:begin])
+    header[-4:] = bytes(4)
+    if zlib.crc32(data[begin:end], zlib.crc32(header)) != crc:
+        raise ShardError(f"checksum mismatch in shard at byte {offset}")
+    return Shard(flags, start_rank, count, bytes(data[begin:end])), end
+
+
+def iter_shard_log(path: str, offset: int = 0):
+    """Yield (shard, end_offset) for each shard in a log, from `offset` on."""
+    with open(path, "rb") as f:
+        data = f.read()
+    while offset < len(data):
+        shard, offset = decode_shard(data, offset)
+        yield shard, offset
+
+
+def append_shard(path: str, shard: bytes) -> None:
+    """Append a shard to a log and fsync it."""
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, "ab") as f:
+        f.write(shard)
+        f.flush()
+        os.fsync(f.fileno())
+
+
+# ---------------------------------------------------------------------------
+# SQLite bridge
+# ---------------------------------------------------------------------------
+
+def shard_perm_indexes(shard: Shard) -> list[int]:
+    """perm_index of each record's canonical board (needs the rank table)."""
+    if shard.flags & SHARD_RANKED:
+        boards = [board_unrank(rank) for rank in shard.ranks()]
+    else:
+        boards, _ = enumerate_canonical(cursor_at_rank(shard.start_rank), shard.count)
+    return list(perm_indexes_of(boards))
+
+
+def import_log(path: str) -> int:
+    """
+    Load the shards of a log that are not yet in niya.db. Progress is kept
+    per log file, so re-running only imports what was appended since.
+    Returns the number of boards imported.
+    """
+    imported = 0
+    for shard, end in iter_shard_log(path, get_import_offset(path)):
+        solutions, p2_rows = shard.rows(shard_perm_indexes(shard))
+        save_batch(solutions, p2_rows, import_progress=(path, end))
+        imported += shard.count
+    return imported
+
+
+def export_db(path: str, shard_size: int = 65536) -> int:
+    """Write every board in niya.db to `path` as sparse shards. Returns the count."""
+    conn = sqlite3.connect(DB_PATH)
+    p2_by_index: dict[int, list[tuple]] = {}
+    for row in conn.execute("SELECT * FROM p2_responses"):
+        p2_by_index.setdefault(row[0], []).append(row)
+    with_p2 = bool(p2_by_index)
+
+    solutions = conn.execute("SELECT * FROM solutions").fetchall()
+    conn.close()
+    _, _, ranks = canonicalize_boards(perm_index_boards([solution[0] for solution in solutions]))
+    keyed = [(rank, [solution], p2_by_index.get(solution[0], []))
+             for rank, solution in zip(ranks, solutions)]
+    keyed.sort()
+
+    with open(path, "wb") as f:
+        for i in range(0, len(keyed), shard_size):
+            chunk = keyed[i:i + shard_size]
+            f.write(encode_shard([(sol, p2) for _, sol, p2 in chunk], with_p2,
+                                 ranks=[rank for rank, _, _ in chunk]))
+    return len(keyed)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Niya result shard tools.")
+    sub = parser.add_subparsers(dest="command", required=True)
+    for name, text in (("info", "Verify a shard log and summarize it."),
+                       ("import", "Load new shards from a log into niya.db."),
+                       ("export", "Write niya.db to a log of sparse shards.")):
+        cmd = sub.add_parser(name, help=text)
+        cmd.add_argument("path", nargs="?", default=SHARD_LOG_PATH,
+                         help="Shard log (default: data/results.shards).")
+    args = parser.parse_args()
+
+    if args.command == "info":
+        shards = boards = p2 = 0
+        for shard, _ in iter_shard_log(args.path):
+            shards += 1
+            boards += shard.count
+            p2 += shard.count if shard.has_p2 else 0
+        size = os.path.getsize(args.path)
+        print(f"[*] {args.path}: {shards:,} shards, {boards:,} boards "
+              f"({p2:,} with P2 records), {size:,} bytes, checksums OK")
+    elif not load_rank_table():
+        raise SystemExit("[!] No rank table: run `python src/main.py --build-rank-table` first")
+    elif args.command == "import":
+        init_db()
+        print(f"[*] Imported {import_log(args.path):,} boards from {args.path}")
+    else:
+        print(f"[*] Exported {export_db(args.path):,} boards to {args.path}")
+
+
+if __name__ == "__main__":
+    main()
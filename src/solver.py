@@ -10,7 +10,8 @@ Three implementations (selected automatically):
 import ctypes
 import os
 
-from models import Board, Outcome, P2Response, SolveResult, classify_position
+from models import (Board, BoardTrace, Outcome, P2Response, SolveResult, SolverStats,
+                    classify_position)
 from utils import is_canonical
 
 
@@ -30,12 +31,52 @@ class _CSolveResult(ctypes.Structure):
         ("p2_outcomes",  ctypes.c_int8 * 12),
     ]
 
+class _CSolverStats(ctypes.Structure):
+    """Mirrors the SolverStats struct in solver_core.c"""
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        "boards", "nodes", "endgame_nodes", "tt_probes", "tt_hits", "tt_stores",
+        "tt_evictions", "pc_probes", "pc_hits", "cutoffs", "first_child_cutoffs", "max_depth",
+        "phase1_ns", "phase2_ns",
+    )]
+
+class _CBoardTrace(ctypes.Structure):
+    """Mirrors the BoardTrace struct in solver_core.c"""
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        "nodes", "ns", "phase2_nodes", "p2_fail_nodes", "p2_late_nodes",
+    )] + [(name, ctypes.c_uint64 * 17) for name in (
+        "depth_nodes", "depth_tt_probes", "depth_tt_hits", "reply_nodes",
+    )]
+
 _c_lib = None
 _c_solve = None
-
-def _load_c_solver():
+_c_solve_batch = None
+_c_solve_trace = None
+_c_solve_parallel = None
+_c_solve_dfpn = None
+_c_stats_enabled = False
+_c_trace_enabled = False
+
+# solve_boards_batch_c flags (must match C code)
+_BATCH_SKIP_P2 = 1
+_BATCH_DFPN = 2
+
+# C search engines for the root tests: depth-first alpha-beta (minimax) or
+# proof-number search (df-pn). Both give the same SolveResult.
+ENGINES = ("alphabeta", "dfpn")
+
+# Per-process transposition table size in MB. The C side rounds down to a
+# power of two. Read from NIYA_TT_MB so that spawned
+# worker processes pick up the same setting as the parent.
+DEFAULT_TT_MB = 16
+
+# Shared position cache (see configure_position_cache): off by default.
+# NIYA_POSITION_CACHE="depth:mb" enables it in spawned workers too.
+DEFAULT_POSITION_CACHE_MB = 64
+
+def _load_c_solver(tt_mb: int | None = None):
     """Attempt to load the C solver shared library."""
-    global _c_lib, _c_solve
+    global _c_lib, _c_solve, _c_solve_batch, _c_solve_parallel, _c_solve_dfpn, _c_stats_enabled
+    global _c_solve_trace, _c_trace_enabled
     so_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "solver_core.so")
     try:
         _c_lib = ctypes.CDLL(so_path)
@@ -47,9 +88,218 @@ def _load_c_solver():
             ctypes.POINTER(_CSolveResult),   # out
         ]
         _c_solve.restype = None
-    except OSError:
+        _c_solve_dfpn = _c_lib.solve_board_dfpn_c
+        _c_solve_dfpn.argtypes = _c_solve.argtypes
+        _c_solve_dfpn.restype = None
+        _c_solve_batch = _c_lib.solve_boards_batch_c
+        _c_solve_batch.argtypes = [
+            ctypes.c_char_p,                 # boards: n * (plants[16], poems[16])
+            ctypes.c_size_t,                 # n
+            ctypes.c_int,                    # flags
+            ctypes.POINTER(_CSolveResult),   # out[n]
+            ctypes.c_int,                    # nthreads (<= 0: one per CPU)
+        ]
+        _c_solve_batch.restype = ctypes.c_int
+        _c_solve_trace = _c_lib.solve_boards_trace_c
+        _c_solve_trace.argtypes = _c_solve_batch.argtypes[:4] + [
+            ctypes.POINTER(_CBoardTrace),    # trace[n]
+            ctypes.c_int,                    # nthreads
+        ]
+        _c_solve_trace.restype = ctypes.c_int
+        _c_solve_parallel = _c_lib.solve_board_parallel_c
+        _c_solve_parallel.argtypes = [
+            ctypes.POINTER(ctypes.c_int8),   # plants[16]
+            ctypes.POINTER(ctypes.c_int8),   # poems[16]
+            ctypes.c_int,                    # skip_p2
+            ctypes.POINTER(_CSolveResult),   # out
+            ctypes.c_int,                    # nthreads (<= 0: one per CPU)
+        ]
+        _c_solve_parallel.restype = ctypes.c_int
+        _c_lib.tt_configure_c.argtypes = [ctypes.c_size_t]
+        _c_lib.tt_configure_c.restype = ctypes.c_size_t
+        _c_lib.position_cache_configure_c.argtypes = [ctypes.c_int, ctypes.c_size_t]
+        _c_lib.position_cache_configure_c.restype = ctypes.c_size_t
+        _c_lib.table_memory_c.argtypes = [ctypes.POINTER(ctypes.c_uint64)]
+        _c_lib.table_memory_c.restype = None
+        _c_lib.pool_pin_c.argtypes = [ctypes.c_char_p, ctypes.c_int]
+        _c_lib.pool_pin_c.restype = ctypes.c_int
+        _c_lib.solver_stats_c.argtypes = [ctypes.POINTER(_CSolverStats), ctypes.c_int]
+        _c_lib.solver_stats_c.restype = ctypes.c_int
+        _c_stats_enabled = bool(_c_lib.solver_stats_c(_CSolverStats(), 1))
+        _c_lib.solver_trace_c.argtypes = [ctypes.POINTER(_CBoardTrace)]
+        _c_lib.solver_trace_c.restype = ctypes.c_int
+        _c_trace_enabled = bool(_c_lib.solver_trace_c(_CBoardTrace()))
+    except (OSError, AttributeError):
         _c_lib = None
         _c_solve = None
+        _c_solve_batch = None
+        _c_solve_trace = None
+        _c_solve_parallel = None
+        _c_solve_dfpn = None
+        return
+
+    if tt_mb is None:
+        tt_mb = int(os.environ.get("NIYA_TT_MB", DEFAULT_TT_MB))
+    configure_tt(tt_mb)
+    if os.environ.get("NIYA_POSITION_CACHE"):
+        depth, _, mb = os.environ["NIYA_POSITION_CACHE"].partition(":")
+        configure_position_cache(int(depth), int(mb or DEFAULT_POSITION_CACHE_MB))
+
+
+def configure_tt(tt_mb: int) -> int:
+    """
+    Set the C solver's transposition table size (per process/thread).
+    Returns the size actually used in MB, or 0 if the C solver isn't loaded.
+    """
+    if _c_lib is None:
+        return 0
+    return _c_lib.tt_configure_c(tt_mb << 20) >> 20
+
+
+def physical_memory_mb() -> int | None:
+    """Installed memory in MB, or None where the OS doesn't report it."""
+    try:
+        return os.sysconf("SC_PHYS_PAGES") * os.sysconf("SC_PAGE_SIZE") >> 20
+    except (AttributeError, ValueError, OSError):
+        return None
+
+
+def check_tt_mb(tt_mb: int, workers: int) -> None:
+    """
+    Exit with a message unless `workers` transposition tables of `tt_mb` MB
+    (the --tt-mb flag of main.py and campaign.py) fit in physical memory.
+    """
+    if tt_mb <= 0:
+        raise SystemExit(f"[!] --tt-mb must be positive, not {tt_mb}")
+    total, memory = tt_mb * workers, physical_memory_mb()
+    if memory is not None and total > memory:
+        raise SystemExit(f"[!] --tt-mb {tt_mb} needs {total:,} MB for {workers} worker "
+                         f"tables, but this machine has {memory:,} MB")
+
+
+def configure_position_cache(depth: int, mb: int = DEFAULT_POSITION_CACHE_MB) -> int:
+    """
+    Share the results of positions with `depth` tiles down (8-15) across
+    every board this process solves, in one table of `mb` MB used by all
+    threads; depth 0 turns the cache off. Reconfiguring empties the table.
+    Returns the size actually used in MB (0 when off or without the C solver).
+    """
+    if _c_lib is None:
+        return 0
+    return _c_lib.position_cache_configure_c(depth, mb << 20) >> 20
+
+
+_PAGE_KINDS = ("normal", "transparent huge", "explicit huge")
+
+
+def table_memory() -> tuple[int, int, int] | None:
+    """
+    Map this thread's transposition table if needed and return its address,
+    size in bytes (less than configured if that much could not be mapped)
+    and page kind (an index into _PAGE_KINDS). None without the C solver.
+    """
+    if _c_lib is None:
+        return None
+    info = (ctypes.c_uint64 * 3)()
+    _c_lib.table_memory_c(info)
+    return tuple(info)
+
+
+def table_pages() -> str | None:
+    """
+    Startup report on this thread's transposition table: its size, the
+    pages it was asked for and, from /proc/self/smaps, the page size that
+    took effect. None without the C solver.
+    """
+    memory = table_memory()
+    if memory is None:
+        return None
+    addr, size, kind = memory
+    fields: dict[str, int] = {}
+    try:
+        with open("/proc/self/smaps") as f:
+            inside = False
+            for line in f:
+                head = line.split(None, 1)[0]
+                if "-" in head and not head.endswith(":"):
+                    start, end = (int(x, 16) for x in head.split("-"))
+                    inside = start <= addr < end
+                elif inside and line.rstrip().endswith(" kB"):
+                    fields[head.rstrip(":")] = int(line.split()[1]) << 10
+    except OSError:
+        return f"{size >> 20} MB, {_PAGE_KINDS[kind]} pages requested"
+    page = fields.get("KernelPageSize", 4096)
+    huge = fields.get("AnonHugePages", 0)
+    if page > 4096:
+        effective = f"{page >> 20} MB pages"
+    elif huge >= size:
+        effective = "2 MB pages"
+    elif huge:
+        effective = f"2 MB pages for {huge / size:.0%} of it, 4 KB for the rest"
+    else:
+        effective = f"{page >> 10} KB pages"
+    return f"{size >> 20} MB, {_PAGE_KINDS[kind]} pages requested: {effective}"
+
+
+def cpu_sets(mode: str) -> list[set[int]]:
+    """
+    CPU sets for pinning workers round-robin: one per CPU this process may
+    use ("core") or one per NUMA node ("node", from /sys; a single set if
+    the topology is unknown).
+    """
+    allowed = os.sched_getaffinity(0)
+    if mode == "core":
+        return [{cpu} for cpu in sorted(allowed)]
+    nodes = []
+    node_dir = "/sys/devices/system/node"
+    for name in sorted(os.listdir(node_dir) if os.path.isdir(node_dir) else []):
+        if not (name.startswith("node") and name[4:].isdigit()):
+            continue
+        with open(os.path.join(node_dir, name, "cpulist")) as f:
+            cpus = set()
+            for part in f.read().strip().split(","):
+                if part:
+                    lo, _, hi = part.partition("-")
+                    cpus.update(range(int(lo), int(hi or lo) + 1))
+        if cpus & allowed:
+            nodes.append(cpus & allowed)
+    return nodes or [set(allowed)]
+
+
+def pin_threads(sets: list[set[int]]) -> bool:
+    """
+    Pin native batch/parallel threads: thread k (the caller is 0) runs on
+    sets[k % len(sets)], so each worker's TT is allocated on its own core's
+    NUMA node. An empty list unpins. Returns False if unsupported.
+    """
+    if _c_lib is None:
+        return False
+    masks = bytearray(128 * len(sets))
+    for k, cpus in enumerate(sets):
+        for cpu in cpus:
+            masks[128 * k + cpu // 8] |= 1 << (cpu % 8)
+    return _c_lib.pool_pin_c(bytes(masks), len(sets)) >= 0
+
+
+def read_stats(reset: bool = True) -> SolverStats | None:
+    """
+    Search counters summed over all boards and threads since the last reset,
+    or None unless the C solver was built with -DNIYA_STATS. Boards solved
+    in other processes (the process-pool fallback) are not included.
+    """
+    if not _c_stats_enabled:
+        return None
+    raw = _CSolverStats()
+    _c_lib.solver_stats_c(ctypes.byref(raw), 1 if reset else 0)
+    return SolverStats(
+        boards=raw.boards, nodes=raw.nodes, endgame_nodes=raw.endgame_nodes,
+        tt_probes=raw.tt_probes, tt_hits=raw.tt_hits,
+        tt_stores=raw.tt_stores, tt_evictions=raw.tt_evictions,
+        pc_probes=raw.pc_probes, pc_hits=raw.pc_hits,
+        cutoffs=raw.cutoffs, first_child_cutoffs=raw.first_child_cutoffs,
+        max_depth=raw.max_depth,
+        phase1_seconds=raw.phase1_ns / 1e9, phase2_seconds=raw.phase2_ns / 1e9,
+    )
 
 _load_c_solver()
 
@@ -200,38 +450,46 @@ def minimax(
     beta: int,
     depth: int,
     cache: dict | None = None,
-) -> tuple[int, int, int]:
+) -> int:
     """
-    Core recursive minimax solver with alpha-beta pruning.
-    Returns (score, outcome_index, game_depth).
-    Uses int sentinels instead of float('inf') and int outcome indices
-    instead of Outcome enum.
+    Core recursive minimax solver with alpha-beta pruning (fail-soft).
+    Returns the position's score from P1's view. Like the C solver, only the
+    score is searched for; how the game ends along the optimal line is
+    recovered by _pv_walk.
+
+    The cache maps (p1_mask, p2_mask, last_move_idx) to (lo, hi) score
+    bounds: a result that failed high or low is only a bound, so it is never
+    reused as an exact value under a wider window.
     """
     # --- Transposition table lookup ---
+    known_lo, known_hi = P1_LOSES, P1_WINS
+    cache_key = (p1_mask, p2_mask, last_move_idx)
     if cache is not None:
-        cache_key = (p1_mask, p2_mask, last_move_idx, is_p1_turn)
         cached = cache.get(cache_key)
         if cached is not None:
-            return cached
-    else:
-        cache_key = None
+            lo, hi = cached
+            if lo == hi or lo >= beta:
+                return lo
+            if hi <= alpha:
+                return hi
+            known_lo, known_hi = lo, hi
+            alpha = max(alpha, lo)
+            beta = min(beta, hi)
 
     # 1. Check if the PREVIOUS move won the game
     prev_mask = p2_mask if is_p1_turn else p1_mask
-    for wm, out_idx in WIN_MASKS:
+    for wm in WIN_BITMASKS:
         if (prev_mask & wm) == wm:
             score = P1_LOSES if is_p1_turn else P1_WINS
-            result = (score, out_idx, depth)
             if cache is not None:
-                cache[cache_key] = result
-            return result
+                cache[cache_key] = (score, score)
+            return score
 
     # 2. Handle full board (Draw)
     if depth == 16:
-        result = (DRAW_SCORE, _OUT_DRAW, 16)
         if cache is not None:
-            cache[cache_key] = result
-        return result
+            cache[cache_key] = (DRAW_SCORE, DRAW_SCORE)
+        return DRAW_SCORE
 
     # 3. Get legal moves (inlined)
     taken_mask = p1_mask | p2_mask
@@ -250,59 +508,116 @@ def minimax(
     # 4. Check Blockade
     if not moves:
         score = P1_LOSES if is_p1_turn else P1_WINS
-        result = (score, _OUT_BLOCKADE, depth)
         if cache is not None:
-            cache[cache_key] = result
-        return result
+            cache[cache_key] = (score, score)
+        return score
 
     # 5. Recurse
     next_depth = depth + 1
+    alpha0, beta0 = alpha, beta
 
     if is_p1_turn:
         best_score = _NEG_INF
-        best_out = _OUT_DRAW
-        best_d = 16
-
         for move in moves:
-            new_p1 = p1_mask | (1 << move)
-            s, o, d = minimax(board, new_p1, p2_mask, move, False,
-                              alpha, beta, next_depth, cache)
+            s = minimax(board, p1_mask | (1 << move), p2_mask, move, False,
+                        alpha, beta, next_depth, cache)
             if s > best_score:
                 best_score = s
-                best_out = o
-                best_d = d
             if s > alpha:
                 alpha = s
             if beta <= alpha:
                 break
-
-        result = (best_score, best_out, best_d)
-        if cache is not None:
-            cache[cache_key] = result
-        return result
-
     else:
         best_score = _INF
-        best_out = _OUT_DRAW
-        best_d = 16
-
         for move in moves:
-            new_p2 = p2_mask | (1 << move)
-            s, o, d = minimax(board, p1_mask, new_p2, move, True,
-                              alpha, beta, next_depth, cache)
+            s = minimax(board, p1_mask, p2_mask | (1 << move), move, True,
+                        alpha, beta, next_depth, cache)
             if s < best_score:
                 best_score = s
-                best_out = o
-                best_d = d
             if s < beta:
                 beta = s
             if beta <= alpha:
                 break
 
-        result = (best_score, best_out, best_d)
-        if cache is not None:
-            cache[cache_key] = result
-        return result
+    # Fail-low gives an upper bound, fail-high a lower bound
+    if cache is not None:
+        lo, hi = known_lo, known_hi
+        if best_score <= alpha0:
+            hi = best_score
+        elif best_score >= beta0:
+            lo = best_score
+        else:
+            lo = hi = best_score
+        if lo != P1_LOSES or hi != P1_WINS:
+            cache[cache_key] = (lo, hi)
+    return best_score
+
+
+# ---------------------------------------------------------------------------
+# Root driver for the Python solver (mirrors the C zero-window driver, so
+# both pick the same moves and report the same lines)
+# ---------------------------------------------------------------------------
+
+def _value_at_least(board: Board, p1_mask: int, p2_mask: int, last_move: int,
+                    is_p1_turn: bool, target: int, depth: int, cache: dict) -> bool:
+    """Zero-window test: is the position's value >= target?"""
+    return minimax(board, p1_mask, p2_mask, last_move, is_p1_turn,
+                   target - 1, target, depth, cache) >= target
+
+
+def _exact_value(board: Board, p1_mask: int, p2_mask: int, last_move: int,
+                 is_p1_turn: bool, depth: int, cache: dict) -> int:
+    """Exact value: "can P1 force a win?", then "can P1 avoid losing?"."""
+    if _value_at_least(board, p1_mask, p2_mask, last_move, is_p1_turn, P1_WINS, depth, cache):
+        return P1_WINS
+    if _value_at_least(board, p1_mask, p2_mask, last_move, is_p1_turn, DRAW_SCORE, depth, cache):
+        return DRAW_SCORE
+    return P1_LOSES
+
+
+def _first_optimal_move(board: Board, p1_mask: int, p2_mask: int, moves: list[int],
+                        is_p1_turn: bool, value: int, next_depth: int, cache: dict) -> int:
+    """Lowest-index move in `moves` whose child keeps the known `value`."""
+    if value == (P1_LOSES if is_p1_turn else P1_WINS):
+        return moves[0]
+    for move in moves:
+        bit = 1 << move
+        if is_p1_turn:
+            keeps = _value_at_least(board, p1_mask | bit, p2_mask, move, False,
+                                    value, next_depth, cache)
+        else:
+            keeps = not _value_at_least(board, p1_mask, p2_mask | bit, move, True,
+                                        value + 1, next_depth, cache)
+        if keeps:
+            return move
+    return -1  # unreachable when value is exact
+
+
+def _pv_walk(board: Board, p1_mask: int, p2_mask: int, last_move: int,
+             is_p1_turn: bool, value: int, depth: int, cache: dict) -> tuple[int, int]:
+    """
+    Play out the canonical principal variation (both sides always take the
+    lowest-index optimal move). Returns (outcome_index, game_depth).
+    """
+    while True:
+        win = _check_win_outcome(p2_mask if is_p1_turn else p1_mask)
+        if win >= 0:
+            return win, depth
+        if depth == 16:
+            return _OUT_DRAW, depth
+        moves = get_legal_moves(board, p1_mask | p2_mask, last_move)
+        if not moves:
+            return _OUT_BLOCKADE, depth
+
+        move = _first_optimal_move(board, p1_mask, p2_mask, moves, is_p1_turn,
+                                   value, depth + 1, cache)
+        if is_p1_turn:
+            p1_mask |= 1 << move
+        else:
+            p2_mask |= 1 << move
+        last_move = move
+        is_p1_turn = not is_p1_turn
+        depth += 1
 
 
 # ---------------------------------------------------------------------------
@@ -431,19 +746,29 @@ def solve_board(
     debug: bool = False,
     skip_canonical: bool = False,
     skip_p2: bool = False,
+    threads: int = 1,
+    engine: str = "alphabeta",
 ) -> SolveResult:
     """
     Fully solve a board: find P1's best opening, optionally analyze all P2
     responses, and return enriched statistics for heuristic derivation.
 
     Uses the C solver when available (much faster), falls back to Python.
-    Debug mode always uses the Python path for verbose output.
+    Debug mode always uses the Python path for verbose output. With
+    `threads` other than 1 the C solver spreads this one board over that
+    many native threads (0 = one per CPU) for lower latency; results are
+    the same. `engine` picks the C search (see ENGINES); df-pn runs on one
+    thread.
     """
     if not skip_canonical and not is_canonical(tuple(board)):
         return SolveResult.duplicate()
 
     # Use C solver for production path
     if _c_solve is not None and not debug:
+        if engine == "dfpn":
+            return _solve_board_c(board, skip_p2, engine=engine)
+        if threads != 1 and _c_solve_parallel is not None:
+            return _solve_board_c(board, skip_p2, threads)
         return _solve_board_c(board, skip_p2)
 
     # Fallback to Python
@@ -455,15 +780,104 @@ def solve_board(
     return _solve_board_python(board, cache, skip_p2)
 
 
-def _solve_board_c(board: Board, skip_p2: bool) -> SolveResult:
-    """Solve via the C shared library."""
+def has_native_batch() -> bool:
+    """True if the C library's batch solver is available."""
+    return _c_solve_batch is not None
+
+
+def has_tracing() -> bool:
+    """True if the C library was built with -DNIYA_TRACE (see solve_boards_traced)."""
+    return _c_trace_enabled
+
+
+def solve_boards(
+    boards: list[Board],
+    skip_p2: bool = False,
+    threads: int = 0,
+    engine: str = "alphabeta",
+) -> list[SolveResult]:
+    """
+    Solve many canonical boards in one call. With the C library the whole
+    batch goes through solve_boards_batch_c as one byte buffer and is spread
+    over `threads` native threads (0 = one per CPU); otherwise each board is
+    solved in turn. Boards are assumed canonical (no duplicate check).
+    `engine` picks the C search, as for solve_board.
+    """
+    if _c_solve_batch is None:
+        return [solve_board(b, skip_canonical=True, skip_p2=skip_p2) for b in boards]
+
+    results = (_CSolveResult * max(len(boards), 1))()
+    _c_solve_batch(_pack_boards(boards), len(boards), _batch_flags(skip_p2, engine),
+                   results, threads)
+    return [_result_from_c(results[i], skip_p2) for i in range(len(boards))]
+
+
+def solve_boards_traced(
+    boards: list[Board],
+    skip_p2: bool = False,
+    threads: int = 0,
+    engine: str = "alphabeta",
+) -> tuple[list[SolveResult], list[BoardTrace]]:
+    """
+    solve_boards, also returning each board's search trace. Needs a C
+    library built with -DNIYA_TRACE (see has_tracing).
+    """
+    if not _c_trace_enabled:
+        raise RuntimeError("solve_boards_traced needs solver_core.so built with -DNIYA_TRACE")
+
+    n = len(boards)
+    results = (_CSolveResult * max(n, 1))()
+    traces = (_CBoardTrace * max(n, 1))()
+    _c_solve_trace(_pack_boards(boards), n, _batch_flags(skip_p2, engine), results, traces,
+                   threads)
+    return ([_result_from_c(results[i], skip_p2) for i in range(n)],
+            [_trace_from_c(traces[i]) for i in range(n)])
+
+
+def _pack_boards(boards: list[Board]) -> bytes:
+    """Boards as the batch solver's buffer: n * (plants[16], poems[16])."""
+    buf = bytearray(32 * len(boards))
+    for i, board in enumerate(boards):
+        base = 32 * i
+        for j, (plant, poem) in enumerate(board):
+            buf[base + j] = plant
+            buf[base + 16 + j] = poem
+    return bytes(buf)
+
+
+def _batch_flags(skip_p2: bool, engine: str) -> int:
+    return (_BATCH_SKIP_P2 if skip_p2 else 0) | (_BATCH_DFPN if engine == "dfpn" else 0)
+
+
+def _trace_from_c(trace: _CBoardTrace) -> BoardTrace:
+    """Convert a filled _CBoardTrace into a BoardTrace."""
+    return BoardTrace(
+        nodes=trace.nodes, seconds=trace.ns / 1e9, phase2_nodes=trace.phase2_nodes,
+        p2_fail_nodes=trace.p2_fail_nodes, p2_late_nodes=trace.p2_late_nodes,
+        depth_nodes=list(trace.depth_nodes), depth_tt_probes=list(trace.depth_tt_probes),
+        depth_tt_hits=list(trace.depth_tt_hits), reply_nodes=list(trace.reply_nodes),
+    )
+
+
+def _solve_board_c(board: Board, skip_p2: bool, threads: int | None = None,
+                   engine: str = "alphabeta") -> SolveResult:
+    """Solve via the C shared library, on `threads` threads if given (alpha-beta only)."""
     # Pack board into C arrays
     plants = (ctypes.c_int8 * 16)(*(t[0] for t in board))
     poems  = (ctypes.c_int8 * 16)(*(t[1] for t in board))
     result = _CSolveResult()
 
-    _c_solve(plants, poems, 1 if skip_p2 else 0, ctypes.byref(result))
+    if engine == "dfpn":
+        _c_solve_dfpn(plants, poems, 1 if skip_p2 else 0, ctypes.byref(result))
+    elif threads is None:
+        _c_solve(plants, poems, 1 if skip_p2 else 0, ctypes.byref(result))
+    else:
+        _c_solve_parallel(plants, poems, 1 if skip_p2 else 0, ctypes.byref(result), threads)
+    return _result_from_c(result, skip_p2)
+
 
+def _result_from_c(result: _CSolveResult, skip_p2: bool) -> SolveResult:
+    """Convert a filled _CSolveResult into a SolveResult."""
     best_move = int(result.best_move)
     best_score = int(result.score)
     best_outcome = OUTCOME_TABLE[int(result.outcome)]
@@ -509,27 +923,20 @@ def _solve_board_c(board: Board, skip_p2: bool) -> SolveResult:
 
 
 def _solve_board_python(board: Board, cache: dict, skip_p2: bool) -> SolveResult:
-    """Solve using the Python minimax (fallback)."""
-    alpha = _NEG_INF
-    beta = _INF
-    best_move = -1
-    best_score = _NEG_INF
-    best_out_idx = _OUT_DRAW
-    best_depth = 16
-
-    for move in OPENING_INDICES:
-        p1_mask = 1 << move
-        s, o, d = minimax(board, p1_mask, 0, move, False,
-                          alpha, beta, 1, cache)
-        if s > best_score:
-            best_score = s
-            best_move = move
-            best_out_idx = o
-            best_depth = d
-        if s > alpha:
-            alpha = s
-        if beta <= alpha:
+    """Solve using the Python minimax (fallback). Same results as the C solver."""
+    # Phase 1: the first opening that can force a win, else the first that
+    # can force a draw; if neither exists every opening loses
+    best_move = OPENING_INDICES[0]
+    best_score = P1_LOSES
+    for target in (P1_WINS, DRAW_SCORE):
+        for move in OPENING_INDICES:
+            if _value_at_least(board, 1 << move, 0, move, False, target, 1, cache):
+                best_move, best_score = move, target
+                break
+        if best_score != P1_LOSES:
             break
+    best_out_idx, best_depth = _pv_walk(board, 1 << best_move, 0, best_move, False,
+                                        best_score, 1, cache)
 
     is_win = best_score == P1_WINS
     is_draw = best_score == DRAW_SCORE
@@ -541,7 +948,7 @@ def _solve_board_python(board: Board, cache: dict, skip_p2: bool) -> SolveResult
         p2_wins_count = 0
         draws_count = 0
     else:
-        p2_responses = _analyze_p2_responses(board, cache)
+        p2_responses = _analyze_p2_responses(board, cache, best_move, best_score)
         p1_wins_count = sum(1 for r in p2_responses if r.is_p1_win)
         draws_count = sum(1 for r in p2_responses if r.outcome == Outcome.DRAW)
         p2_wins_count = len(p2_responses) - p1_wins_count - draws_count
@@ -625,10 +1032,11 @@ def _solve_board_debug(
 
 
 def _analyze_p2_responses(
-    board: Board, cache: dict,
+    board: Board, cache: dict, best_move: int, best_score: int,
 ) -> list[P2Response]:
     """
-    For each possible P1 opening move, find P2's optimal response.
+    For each possible P1 opening move, find P2's optimal response (the
+    lowest-index reply that holds the opening to its value).
     Reuses the transposition cache from phase 1 for efficiency.
     Fast path (no debug output).
     """
@@ -636,37 +1044,19 @@ def _analyze_p2_responses(
 
     for p1_move in OPENING_INDICES:
         p1_mask = 1 << p1_move
+        if p1_move == best_move:
+            value = best_score
+        else:
+            value = _exact_value(board, p1_mask, 0, p1_move, False, 1, cache)
+        replies = get_legal_moves(board, p1_mask, p1_move)
+        p2_move = _first_optimal_move(board, p1_mask, 0, replies, False, value, 2, cache)
+        outcome, _ = _pv_walk(board, p1_mask, 1 << p2_move, p2_move, True, value, 2, cache)
 
-        # Inline legal move generation for P2
-        taken_mask = p1_mask
-        last_tile = board[p1_move]
-        tp = last_tile[0]
-        ts = last_tile[1]
-
-        best_p2_move = -1
-        best_p2_score = _INF
-        best_p2_out = _OUT_DRAW
-
-        for i in range(16):
-            if not (taken_mask & (1 << i)):
-                curr = board[i]
-                if curr[0] == tp or curr[1] == ts:
-                    p2_mask = 1 << i
-                    s, o, _ = minimax(
-                        board, p1_mask, p2_mask, i, True,
-                        _NEG_INF, _INF, 2, cache,
-                    )
-                    if s < best_p2_score:
-                        best_p2_score = s
-                        best_p2_move = i
-                        best_p2_out = o
-
-        is_p1_win = best_p2_score == P1_WINS
         results.append(P2Response(
             p1_move=p1_move,
-            p2_best_move=best_p2_move,
-            is_p1_win=is_p1_win,
-            outcome=OUTCOME_TABLE[best_p2_out],
+            p2_best_move=p2_move,
+            is_p1_win=value == P1_WINS,
+            outcome=OUTCOME_TABLE[outcome],
         ))
 
     return results
@@ -3,15 +3,41 @@
  *
  * Compiled as shared library, called from Python via ctypes.
  * Board represented as int8 arrays: plants[16] and poems[16].
- * Player state tracked via 16-bit bitmasks.
+ * Player state tracked via 16-bit bitmasks; legal moves come from per-board
+ * compatibility bitmasks (see build_compat).
  *
  * Build: cc -O3 -shared -o solver_core.so solver_core.c  (macOS)
- *        cc -O3 -shared -fPIC -o solver_core.so solver_core.c  (Linux)
+ *        cc -O3 -march=native -pthread -shared -fPIC -o solver_core.so solver_core.c  (Linux)
+ * Add -DNIYA_STATS for search counters (see solver_stats_c) and
+ * -DNIYA_TRACE for per-board search traces (see solve_boards_trace_c);
+ * without them they compile to nothing.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE   /* pthread_setaffinity_np */
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Board kernels use SSSE3 (pshufb) or AArch64 NEON (tbl) when the compiler
+ * targets them (e.g. -march=native); -DNIYA_NO_SIMD forces the scalar path. */
+#if !defined(NIYA_NO_SIMD) && defined(__SSSE3__)
+#include <tmmintrin.h>
+#define NIYA_SIMD_SSSE3 1
+#elif !defined(NIYA_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NIYA_SIMD_NEON 1
+#endif
 
 /* ---- Outcome indices (match Python OUTCOME_TABLE) ---- */
 #define OUT_ROW          0
@@ -64,388 +90,2373 @@ static const WinPattern WIN_PATTERNS[] = {
 static const int OPENING_INDICES[] = {0,1,2,3,4,7,8,11,12,13,14,15};
 #define NUM_OPENINGS 12
 
-/* ---- Transposition table (simple hash map with open addressing) ---- */
+/* 8 spatial symmetries of the grid: TRANSFORM_MAPS[t][i] = source index for
+ * position i. Used by root symmetry pruning and by canonicalization. */
+static const uint8_t TRANSFORM_MAPS[8][16] = {
+    /* Identity */
+    { 0, 1, 2, 3,  4, 5, 6, 7,  8, 9,10,11, 12,13,14,15},
+    /* 90° CW rotation */
+    {12, 8, 4, 0, 13, 9, 5, 1, 14,10, 6, 2, 15,11, 7, 3},
+    /* 180° rotation */
+    {15,14,13,12, 11,10, 9, 8,  7, 6, 5, 4,  3, 2, 1, 0},
+    /* 270° CW rotation */
+    { 3, 7,11,15,  2, 6,10,14,  1, 5, 9,13,  0, 4, 8,12},
+    /* Horizontal reflection (flip rows) */
+    {12,13,14,15,  8, 9,10,11,  4, 5, 6, 7,  0, 1, 2, 3},
+    /* Vertical reflection (flip cols) */
+    { 3, 2, 1, 0,  7, 6, 5, 4, 11,10, 9, 8, 15,14,13,12},
+    /* Main diagonal transpose */
+    { 0, 4, 8,12,  1, 5, 9,13,  2, 6,10,14,  3, 7,11,15},
+    /* Anti-diagonal transpose */
+    {15,11, 7, 3, 14,10, 6, 2, 13, 9, 5, 1, 12, 8, 4, 0},
+};
+
+/* ---- Search statistics ---- */
 /*
- * Key: (p1_mask, p2_mask, last_move, is_p1_turn) packed into 37 bits.
- *      p1_mask: 16 bits, p2_mask: 16 bits, last_move: 4 bits, turn: 1 bit
- * We use a power-of-2 sized table with linear probing.
+ * With -DNIYA_STATS each thread counts into its own thread_stats while it
+ * solves, and solve_board_c folds them into solver_stats once per board
+ * (atomic adds), so the hot path never touches shared memory. Without the
+ * flag STAT() expands to nothing and solver_stats_c reports zeros.
  */
-#define TT_SIZE_BITS 20
-#define TT_SIZE      (1 << TT_SIZE_BITS)  /* 1M entries */
-#define TT_MASK      (TT_SIZE - 1)
-
 typedef struct {
-    uint64_t key;     /* full key (0 = empty) */
-    int8_t   score;
-    int8_t   outcome;
-    int8_t   depth;
-} TTEntry;
-
-static inline uint64_t tt_make_key(uint16_t p1, uint16_t p2, int last, int turn) {
-    /* Pack into a non-zero key (add 1 to avoid 0 = empty sentinel) */
-    return ((uint64_t)p1 << 21) | ((uint64_t)p2 << 5) | ((uint64_t)(last & 0xF) << 1) | (turn & 1) | ((uint64_t)1 << 37);
-}
-
-static inline int tt_lookup(TTEntry *tt, uint64_t key, int8_t *score, int8_t *outcome, int8_t *depth) {
-    uint32_t idx = (uint32_t)(key * 0x9E3779B97F4A7C15ULL >> (64 - TT_SIZE_BITS)) & TT_MASK;
-    for (int probe = 0; probe < 8; probe++) {
-        uint32_t i = (idx + probe) & TT_MASK;
-        if (tt[i].key == key) {
-            *score   = tt[i].score;
-            *outcome = tt[i].outcome;
-            *depth   = tt[i].depth;
-            return 1;
-        }
-        if (tt[i].key == 0) return 0;
-    }
-    return 0;
+    uint64_t boards;              /* boards solved */
+    uint64_t nodes;               /* minimax and endgame calls */
+    uint64_t endgame_nodes;       /* ... in the endgame kernel */
+    uint64_t tt_probes;
+    uint64_t tt_hits;             /* probes that found the position */
+    uint64_t tt_stores;
+    uint64_t tt_evictions;        /* stores that replaced another position */
+    uint64_t pc_probes;           /* shared position cache lookups */
+    uint64_t pc_hits;             /* ... that found the position */
+    uint64_t cutoffs;             /* beta cutoffs */
+    uint64_t first_child_cutoffs; /* ... on the first child searched */
+    uint64_t max_depth;           /* most tiles placed at any node */
+    uint64_t phase1_ns;           /* best opening and its line */
+    uint64_t phase2_ns;           /* P2 analysis */
+} SolverStats;
+
+#if defined(NIYA_STATS) || defined(NIYA_TRACE)
+#include <time.h>
+
+static inline uint64_t stat_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
 }
+#endif
 
-static inline void tt_store(TTEntry *tt, uint64_t key, int8_t score, int8_t outcome, int8_t depth) {
-    uint32_t idx = (uint32_t)(key * 0x9E3779B97F4A7C15ULL >> (64 - TT_SIZE_BITS)) & TT_MASK;
-    for (int probe = 0; probe < 8; probe++) {
-        uint32_t i = (idx + probe) & TT_MASK;
-        if (tt[i].key == 0 || tt[i].key == key) {
-            tt[i].key     = key;
-            tt[i].score   = score;
-            tt[i].outcome = outcome;
-            tt[i].depth   = depth;
-            return;
+#ifdef NIYA_STATS
+#define STAT(stmt) do { stmt; } while (0)
+
+static SolverStats solver_stats;
+static __thread SolverStats thread_stats;
+
+static void stat_flush_thread(void) {
+    uint64_t *dst = (uint64_t *)&solver_stats;
+    uint64_t *src = (uint64_t *)&thread_stats;
+    size_t max_i = offsetof(SolverStats, max_depth) / sizeof(uint64_t);
+    for (size_t i = 0; i < sizeof(SolverStats) / sizeof(uint64_t); i++) {
+        if (i == max_i) {
+            uint64_t cur = __atomic_load_n(&dst[i], __ATOMIC_RELAXED);
+            while (src[i] > cur &&
+                   !__atomic_compare_exchange_n(&dst[i], &cur, src[i], 1,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                ;
+        } else {
+            __atomic_fetch_add(&dst[i], src[i], __ATOMIC_RELAXED);
         }
     }
-    /* Table full in this bucket — replace first slot (simple eviction) */
-    tt[idx].key     = key;
-    tt[idx].score   = score;
-    tt[idx].outcome = outcome;
-    tt[idx].depth   = depth;
+    memset(&thread_stats, 0, sizeof(thread_stats));
 }
+#else
+#define STAT(stmt) do { } while (0)
+#endif
+
+/* ---- Search tracing ---- */
+/*
+ * With -DNIYA_TRACE each thread records where the search of the board it
+ * is solving goes, in thread_trace: nodes and TT probes by depth (tiles
+ * placed), nodes by number of legal replies, and the nodes spent under P2
+ * replies that failed to refute P1's move. solve_board clears it for each
+ * board and stamps the totals at the end, and the batch driver copies it
+ * out per board. Without the flag TRACE() expands to nothing.
+ */
+typedef struct {
+    uint64_t nodes;               /* minimax, endgame and df-pn calls */
+    uint64_t ns;                  /* wall time for the board */
+    uint64_t phase2_nodes;        /* ... of the nodes, in P2 analysis */
+    uint64_t p2_fail_nodes;       /* under P2 replies that did not cut off */
+    uint64_t p2_late_nodes;       /* ... at nodes where a later reply did */
+    uint64_t depth_nodes[17];     /* nodes by tiles placed */
+    uint64_t depth_tt_probes[17]; /* TT (or df-pn table) probes by tiles placed */
+    uint64_t depth_tt_hits[17];   /* ... that found the position */
+    uint64_t reply_nodes[17];     /* nodes that generate moves, by reply count */
+} BoardTrace;
 
+#ifdef NIYA_TRACE
+#define TRACE(stmt) do { stmt; } while (0)
 
-/* ---- Check win ---- */
-static inline int check_win(uint16_t mask) {
-    for (int i = 0; i < NUM_WIN_PATTERNS; i++) {
-        if ((mask & WIN_PATTERNS[i].mask) == WIN_PATTERNS[i].mask)
-            return WIN_PATTERNS[i].outcome;
-    }
-    return -1;
+static __thread BoardTrace thread_trace;
+
+static inline void trace_node(int depth) {
+    thread_trace.nodes++;
+    thread_trace.depth_nodes[depth]++;
 }
 
+static inline void trace_probe(int depth, int found) {
+    thread_trace.depth_tt_probes[depth]++;
+    thread_trace.depth_tt_hits[depth] += (uint64_t)found;
+}
 
-/* ---- Core minimax ---- */
+/*
+ * P2 replies nest, so a node can sit under several failed replies. Each
+ * node is counted once: a failed reply's whole subtree replaces what the
+ * replies nested in it already added. TraceMark is taken before the reply.
+ */
 typedef struct {
-    int8_t score;
-    int8_t outcome;
-    int8_t game_depth;
-} MiniResult;
-
-static MiniResult minimax(
-    const int8_t *plants,   /* plants[16] */
-    const int8_t *poems,    /* poems[16]  */
-    uint16_t p1_mask,
-    uint16_t p2_mask,
-    int last_move,
-    int is_p1_turn,
-    int alpha,
-    int beta,
-    int depth,
-    TTEntry *tt
-) {
-    MiniResult result;
+    uint64_t nodes, p2_fail_nodes, p2_late_nodes;
+} TraceMark;
 
-    /* TT lookup */
-    uint64_t key = tt_make_key(p1_mask, p2_mask, last_move, is_p1_turn);
-    if (tt_lookup(tt, key, &result.score, &result.outcome, &result.game_depth))
-        return result;
+static inline TraceMark trace_mark(void) {
+    return (TraceMark){ thread_trace.nodes, thread_trace.p2_fail_nodes,
+                        thread_trace.p2_late_nodes };
+}
 
-    /* 1. Check if previous move won */
-    uint16_t prev_mask = is_p1_turn ? p2_mask : p1_mask;
-    int win = check_win(prev_mask);
-    if (win >= 0) {
-        result.score      = is_p1_turn ? P1_LOSES : P1_WINS;
-        result.outcome    = (int8_t)win;
-        result.game_depth = (int8_t)depth;
-        tt_store(tt, key, result.score, result.outcome, result.game_depth);
-        return result;
-    }
+/* The reply searched since `m` did not cut off; returns the part of its
+ * subtree not yet counted as late, for the caller to add on a later cutoff */
+static inline uint64_t trace_failed_reply(TraceMark m) {
+    uint64_t subtree = thread_trace.nodes - m.nodes;
+    thread_trace.p2_fail_nodes = m.p2_fail_nodes + subtree;
+    return subtree - (thread_trace.p2_late_nodes - m.p2_late_nodes);
+}
+#else
+#define TRACE(stmt) do { } while (0)
+#endif
 
-    /* 2. Full board = draw */
-    if (depth == 16) {
-        result.score      = DRAW_SCORE;
-        result.outcome    = OUT_DRAW;
-        result.game_depth = 16;
-        tt_store(tt, key, result.score, result.outcome, result.game_depth);
-        return result;
-    }
+/* ---- Table memory ---- */
+/*
+ * The TT, the df-pn table and the shared position cache are probed at
+ * random, so with 4 KB pages nearly every probe into a table of a few MB
+ * or more also misses the TLB. On Linux, tables of at least 2 MB ask for
+ * huge pages: explicit ones first (MAP_HUGETLB, only if pages are
+ * reserved in /proc/sys/vm/nr_hugepages), then transparent ones (a
+ * 2 MB-aligned mapping with MADV_HUGEPAGE), else normal pages. Callers
+ * clear a new table right away, so its pages are faulted in by the thread
+ * that owns it; with pinned workers (pool_pin_c) each worker's table ends
+ * up on its own NUMA node.
+ */
+enum { TABLE_PAGES_NORMAL = 0, TABLE_PAGES_TRANSPARENT, TABLE_PAGES_EXPLICIT };
 
-    /* 3. Get legal moves (match plant or poem of last tile) */
-    uint16_t taken = p1_mask | p2_mask;
-    int8_t target_plant = plants[last_move];
-    int8_t target_poem  = poems[last_move];
+#define TABLE_HUGE_PAGE ((size_t)2 << 20)
 
-    int moves[16];
-    int num_moves = 0;
-    for (int i = 0; i < 16; i++) {
-        if (!(taken & (1 << i))) {
-            if (plants[i] == target_plant || poems[i] == target_poem) {
-                moves[num_moves++] = i;
-            }
+static void *table_alloc(size_t bytes, int *pages) {
+    *pages = TABLE_PAGES_NORMAL;
+#ifdef __linux__
+    void *p;
+    int huge = bytes >= TABLE_HUGE_PAGE && bytes % TABLE_HUGE_PAGE == 0;
+#ifdef MAP_HUGETLB
+    if (huge) {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *pages = TABLE_PAGES_EXPLICIT;
+            return p;
         }
     }
-
-    /* 4. Blockade */
-    if (num_moves == 0) {
-        result.score      = is_p1_turn ? P1_LOSES : P1_WINS;
-        result.outcome    = OUT_BLOCKADE;
-        result.game_depth = (int8_t)depth;
-        tt_store(tt, key, result.score, result.outcome, result.game_depth);
-        return result;
+#endif
+    /* Over-map by one huge page and trim, so the table is 2 MB-aligned */
+    size_t span = huge ? bytes + TABLE_HUGE_PAGE : bytes;
+    p = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    if (huge) {
+        uintptr_t start = ((uintptr_t)p + TABLE_HUGE_PAGE - 1) & ~(uintptr_t)(TABLE_HUGE_PAGE - 1);
+        size_t head = start - (uintptr_t)p;
+        if (head) munmap(p, head);
+        if (TABLE_HUGE_PAGE - head) munmap((void *)(start + bytes), TABLE_HUGE_PAGE - head);
+        p = (void *)start;
+#ifdef MADV_HUGEPAGE
+        if (madvise(p, bytes, MADV_HUGEPAGE) == 0) *pages = TABLE_PAGES_TRANSPARENT;
+#endif
     }
+    return p;
+#else
+    return aligned_alloc(64, bytes);
+#endif
+}
 
-    /* 5. Recurse */
-    int next_depth = depth + 1;
-
-    if (is_p1_turn) {
-        int best_score = NEG_INF;
-        int8_t best_out = OUT_DRAW;
-        int8_t best_d = 16;
-
-        for (int m = 0; m < num_moves; m++) {
-            int move = moves[m];
-            MiniResult r = minimax(plants, poems,
-                                   p1_mask | (uint16_t)(1 << move), p2_mask,
-                                   move, 0, alpha, beta, next_depth, tt);
-            if (r.score > best_score) {
-                best_score = r.score;
-                best_out   = r.outcome;
-                best_d     = r.game_depth;
-            }
-            if (r.score > alpha) alpha = r.score;
-            if (beta <= alpha) break;
-        }
-        result.score      = (int8_t)best_score;
-        result.outcome    = best_out;
-        result.game_depth = best_d;
-    } else {
-        int best_score = INF;
-        int8_t best_out = OUT_DRAW;
-        int8_t best_d = 16;
-
-        for (int m = 0; m < num_moves; m++) {
-            int move = moves[m];
-            MiniResult r = minimax(plants, poems,
-                                   p1_mask, p2_mask | (uint16_t)(1 << move),
-                                   move, 1, alpha, beta, next_depth, tt);
-            if (r.score < best_score) {
-                best_score = r.score;
-                best_out   = r.outcome;
-                best_d     = r.game_depth;
-            }
-            if (r.score < beta) beta = r.score;
-            if (beta <= alpha) break;
-        }
-        result.score      = (int8_t)best_score;
-        result.outcome    = best_out;
-        result.game_depth = best_d;
+/*
+ * A table of unit << *bits bytes, halving it (down to min_bits) while the
+ * mapping fails, e.g. when the size asked for is more than the machine
+ * has. *bits is left at the size used; NULL only if even that failed.
+ */
+static void *table_alloc_fit(size_t unit, int *bits, int min_bits, int *pages) {
+    for (;; (*bits)--) {
+        void *p = table_alloc(unit << *bits, pages);
+        if (p || *bits <= min_bits) return p;
     }
-
-    tt_store(tt, key, result.score, result.outcome, result.game_depth);
-    return result;
 }
 
+static void table_free(void *p, size_t bytes) {
+    if (!p) return;
+#ifdef __linux__
+    munmap(p, bytes);
+#else
+    (void)bytes;
+    free(p);
+#endif
+}
 
-/* ================================================================
- * Public API - called from Python via ctypes
- * ================================================================ */
-
+/* ---- Transposition table (bucketed, one cache line per bucket) ---- */
 /*
- * Result struct returned to Python.
- *   best_move:     P1's best opening move index (0-15)
- *   score:         1 = P1 wins, -1 = P2 wins, 0 = draw
- *   outcome:       outcome index (maps to OUTCOME_TABLE in Python)
- *   game_depth:    total moves until game ends
+ * Key: (p1_mask, p2_mask, last_move) packed into 36 bits. The side to move
+ * is implied by the tile counts, so it is not part of the key.
  *
- * For P2 analysis, 12 additional entries for each P1 opening:
- *   p2_moves[12]:      P2's best response for each P1 opening
- *   p2_scores[12]:     score for each P1 opening line
- *   p2_outcomes[12]:   outcome index for each
+ * The key is scrambled by an invertible multiply mod 2^36. The high
+ * bucket_bits of the result select a 64-byte bucket and the remaining low
+ * bits are stored as the entry's tag, so a tag match is an exact key match
+ * and the full key of any resident entry can be recovered from
+ * (bucket index, tag).
+ *
+ * Bucket layout: a generation word followed by 15 packed 32-bit entries.
+ * A bucket whose generation is not the table's current one reads as empty
+ * and is cleared on first store, so moving on to the next board is a
+ * counter bump instead of a table-sized memset.
+ *
+ * A table can be shared by the threads of a parallel solve. Entries are
+ * single words read and written atomically, and every entry is a sound
+ * bound whoever wrote it, so racing stores can only lose entries. The
+ * first store of a board claims a stale bucket by moving its generation
+ * to TT_GEN_CLEARING, clears it and then publishes the current
+ * generation, so no thread ever reads a previous board's entries.
+ *
+ * Entry layout (0 = empty slot):
+ *   bits  0-24  tag (key bits not implied by the bucket index)
+ *   bits 25-27  value code: score bounds (lo, hi), see tt_encode_value
+ *   bits 28-31  best move found from this position (0 for terminal nodes)
+ *
+ * When a bucket is full the entry with the fewest empty cells (smallest
+ * remaining subtree, cheapest to recompute) is evicted.
  */
+#define TT_KEY_BITS        36
+#define TT_KEY_MASK        (((uint64_t)1 << TT_KEY_BITS) - 1)
+#define TT_MIX_MUL         0x97F4A7C15ULL   /* odd, so invertible mod 2^36 */
+#define TT_MIX_INV         0x19937733DULL   /* TT_MIX_MUL^-1 mod 2^36      */
+#define TT_TAG_FIELD_BITS  25
+#define TT_TAG_FIELD_MASK  ((1u << TT_TAG_FIELD_BITS) - 1)
+#define TT_MIN_BUCKET_BITS (TT_KEY_BITS - TT_TAG_FIELD_BITS)  /* 2^11 buckets = 128 KB */
+#define TT_MAX_BUCKET_BITS 30                                 /* 64 GB */
+#define TT_DEFAULT_BUCKET_BITS 18                             /* 16 MB */
+#define TT_BUCKET_SLOTS    15
+#define TT_GEN_CLEARING    UINT32_MAX  /* bucket being cleared, never a table gen */
+
 typedef struct {
-    int8_t  best_move;
-    int8_t  score;
-    int8_t  outcome;
-    int8_t  game_depth;
-    /* P2 analysis (filled only when skip_p2 == 0) */
-    int8_t  p2_moves[12];
-    int8_t  p2_scores[12];
-    int8_t  p2_outcomes[12];
-} SolveResult;
+    uint32_t gen;                     /* generation that last wrote this bucket */
+    uint32_t slot[TT_BUCKET_SLOTS];   /* packed entries */
+} TTBucket;
 
+typedef struct DfpnTable DfpnTable;
+
+typedef struct {
+    TTBucket  *buckets;
+    uint32_t   gen;          /* current generation (one per solved board) */
+    int        bucket_bits;  /* log2 of the number of buckets */
+    DfpnTable *dfpn;         /* if set, root tests use df-pn (see dfpn_at_least) */
+    int        pages;        /* TABLE_PAGES_*, see table_alloc */
+} TTable;
+
+/* Requested table size for newly (re)allocated per-thread tables */
+static int tt_config_bucket_bits = TT_DEFAULT_BUCKET_BITS;
 
 /*
- * solve_board_c - Solve a single Niya board.
- *
- * Args:
- *   plants[16], poems[16]: board tile attributes
- *   skip_p2: if nonzero, skip P2 analysis
- *   out: pointer to SolveResult to fill
+ * Value codes. Scores are ternary, so every stored bound collapses to one
+ * of five (lo, hi) intervals; a lower bound of +1 or an upper bound of -1
+ * is already exact. Codes start at 1 so that a live entry is never 0.
  */
-void solve_board_c(
-    const int8_t *plants,
-    const int8_t *poems,
-    int skip_p2,
-    SolveResult *out
-) {
-    /* Allocate transposition table on the heap (too large for stack) */
-    static __thread TTEntry *tt = NULL;
-    if (!tt) {
-        tt = (TTEntry *)calloc(TT_SIZE, sizeof(TTEntry));
-    } else {
-        memset(tt, 0, TT_SIZE * sizeof(TTEntry));
+enum { TT_V_LOSS = 1, TT_V_DRAW, TT_V_WIN, TT_V_DRAW_OR_WIN, TT_V_LOSS_OR_DRAW };
+
+static const int8_t TT_CODE_LO[6] = { 0, P1_LOSES, DRAW_SCORE, P1_WINS, DRAW_SCORE, P1_LOSES };
+static const int8_t TT_CODE_HI[6] = { 0, P1_LOSES, DRAW_SCORE, P1_WINS, P1_WINS, DRAW_SCORE };
+
+static inline uint32_t tt_encode_value(int lo, int hi) {
+    if (lo == hi) return (uint32_t)(TT_V_DRAW + lo);
+    return lo == DRAW_SCORE ? TT_V_DRAW_OR_WIN : TT_V_LOSS_OR_DRAW;
+}
+
+static inline uint64_t tt_mix(uint16_t p1, uint16_t p2, int last) {
+    uint64_t key = (uint64_t)p1 | ((uint64_t)p2 << 16) | ((uint64_t)(last & 0xF) << 32);
+    return (key * TT_MIX_MUL) & TT_KEY_MASK;
+}
+
+/* Number of tiles placed in the position stored at (bucket, tag) */
+static inline int tt_entry_depth(const TTable *tt, uint64_t bucket, uint32_t tag) {
+    uint64_t mixed = (bucket << (TT_KEY_BITS - tt->bucket_bits)) | tag;
+    uint64_t key = (mixed * TT_MIX_INV) & TT_KEY_MASK;
+    return __builtin_popcount((uint32_t)((key | (key >> 16)) & 0xFFFF));
+}
+
+typedef struct {
+    int8_t lo, hi;       /* score bounds */
+    int8_t best_move;    /* move-ordering hint */
+} TTHit;
+
+static inline int tt_lookup(const TTable *tt, uint64_t mixed, TTHit *hit) {
+    STAT(thread_stats.tt_probes++);
+    const TTBucket *b = &tt->buckets[mixed >> (TT_KEY_BITS - tt->bucket_bits)];
+    if (__atomic_load_n(&b->gen, __ATOMIC_ACQUIRE) != tt->gen) return 0;
+    uint32_t tag = (uint32_t)(mixed & TT_TAG_FIELD_MASK);
+    for (int s = 0; s < TT_BUCKET_SLOTS; s++) {
+        uint32_t e = __atomic_load_n(&b->slot[s], __ATOMIC_RELAXED);
+        if (e == 0) return 0;  /* slots fill front to back */
+        if ((e & TT_TAG_FIELD_MASK) == tag) {
+            uint32_t code = (e >> 25) & 7;
+            hit->lo        = TT_CODE_LO[code];
+            hit->hi        = TT_CODE_HI[code];
+            hit->best_move = (int8_t)(e >> 28);
+            STAT(thread_stats.tt_hits++);
+            return 1;
+        }
     }
+    return 0;
+}
 
-    /* Phase 1: Find P1's best opening */
-    int alpha = NEG_INF;
-    int beta  = INF;
-    int best_move  = -1;
-    int best_score = NEG_INF;
-    int8_t best_out = OUT_DRAW;
-    int8_t best_d   = 16;
+static inline void tt_store(TTable *tt, uint64_t mixed, int lo, int hi, int best_move) {
+    STAT(thread_stats.tt_stores++);
+    uint64_t bi = mixed >> (TT_KEY_BITS - tt->bucket_bits);
+    TTBucket *b = &tt->buckets[bi];
+    uint32_t gen = __atomic_load_n(&b->gen, __ATOMIC_ACQUIRE);
+    if (gen != tt->gen) {
+        /* Another thread claiming the bucket first just costs this entry */
+        if (gen == TT_GEN_CLEARING ||
+            !__atomic_compare_exchange_n(&b->gen, &gen, TT_GEN_CLEARING, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+        for (int s = 0; s < TT_BUCKET_SLOTS; s++)
+            __atomic_store_n(&b->slot[s], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->gen, tt->gen, __ATOMIC_RELEASE);
+    }
 
-    for (int oi = 0; oi < NUM_OPENINGS; oi++) {
-        int move = OPENING_INDICES[oi];
-        uint16_t p1_mask = (uint16_t)(1 << move);
+    uint32_t tag = (uint32_t)(mixed & TT_TAG_FIELD_MASK);
+    uint32_t e = tag
+               | (tt_encode_value(lo, hi) << 25)
+               | ((uint32_t)best_move << 28);
 
-        MiniResult r = minimax(plants, poems, p1_mask, 0, move, 0,
-                               alpha, beta, 1, tt);
-        if (r.score > best_score) {
-            best_score = r.score;
-            best_move  = move;
-            best_out   = r.outcome;
-            best_d     = r.game_depth;
+    int victim = 0, victim_depth = -1;
+    for (int s = 0; s < TT_BUCKET_SLOTS; s++) {
+        uint32_t old = __atomic_load_n(&b->slot[s], __ATOMIC_RELAXED);
+        if (old == 0 || (old & TT_TAG_FIELD_MASK) == tag) {
+            __atomic_store_n(&b->slot[s], e, __ATOMIC_RELAXED);
+            return;
+        }
+        int d = tt_entry_depth(tt, bi, old & TT_TAG_FIELD_MASK);
+        if (d > victim_depth) {
+            victim = s;
+            victim_depth = d;
         }
-        if (r.score > alpha) alpha = r.score;
-        if (beta <= alpha) break;
     }
+    __atomic_store_n(&b->slot[victim], e, __ATOMIC_RELAXED);
+    STAT(thread_stats.tt_evictions++);
+}
 
-    out->best_move  = (int8_t)best_move;
-    out->score      = (int8_t)best_score;
-    out->outcome    = best_out;
-    out->game_depth = best_d;
+/*
+ * Make sure a table exists at the configured size and start a new
+ * generation for the next board. Must not race with searches using it.
+ * If the configured size cannot be mapped, the table is the largest
+ * smaller one that can, and that becomes the configured size, so every
+ * thread's table ends up the same (reported by table_memory_c).
+ */
+static void tt_begin(TTable *tt) {
+    int bits = __atomic_load_n(&tt_config_bucket_bits, __ATOMIC_RELAXED);
+    if (tt->buckets && tt->bucket_bits != bits) {
+        table_free(tt->buckets, sizeof(TTBucket) << tt->bucket_bits);
+        tt->buckets = NULL;
+    }
+    if (!tt->buckets) {
+        int want = bits;
+        tt->buckets = (TTBucket *)table_alloc_fit(sizeof(TTBucket), &bits,
+                                                  TT_MIN_BUCKET_BITS, &tt->pages);
+        if (!tt->buckets) {
+            fprintf(stderr, "solver_core: cannot map a %zu KB transposition table\n",
+                    (sizeof(TTBucket) << bits) >> 10);
+            abort();
+        }
+        while (bits < want && !__atomic_compare_exchange_n(&tt_config_bucket_bits, &want, bits, 0,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+        memset(tt->buckets, 0, sizeof(TTBucket) << bits);
+        tt->bucket_bits = bits;
+        tt->gen = 0;
+    }
 
-    /* Phase 2: P2 analysis */
-    if (skip_p2) {
-        memset(out->p2_moves,    -1, 12);
-        memset(out->p2_scores,    0, 12);
-        memset(out->p2_outcomes,  0, 12);
-        return;
+    /* Only wipe the table when the generation counter wraps */
+    if (++tt->gen == TT_GEN_CLEARING) {
+        memset(tt->buckets, 0, sizeof(TTBucket) << tt->bucket_bits);
+        tt->gen = 1;
     }
+}
 
-    for (int oi = 0; oi < NUM_OPENINGS; oi++) {
-        int p1_move = OPENING_INDICES[oi];
-        uint16_t p1_mask = (uint16_t)(1 << p1_move);
-        int8_t tp = plants[p1_move];
-        int8_t ts = poems[p1_move];
+/* This thread's own table, ready for the next board */
+static TTable *tt_begin_board(void) {
+    static __thread TTable tt = { NULL, 0, 0, NULL, 0 };
+    tt_begin(&tt);
+    return &tt;
+}
 
-        int p2_best_move  = -1;
-        int p2_best_score = INF;
-        int8_t p2_best_out = OUT_DRAW;
+/* ---- Shared position cache (across boards) ---- */
+/*
+ * The TT above is scoped to one board, but late positions recur across
+ * boards: once D tiles are down, the rest of the game depends only on the
+ * two players' masks, which remaining cells are compatible with each other
+ * and with the last tile. Neither the tiles' labels nor the tiles already
+ * played matter, so one stored result serves every board whose position
+ * has the same compatibility graph, up to the 8 spatial symmetries (the
+ * relabelings and the plant/poem swap keep the graph as is).
+ *
+ * The cache is probed and filled by endgame() at exactly depth D only, so
+ * every entry covers a subtree of the same size and no depth is stored.
+ * It is one table for the whole process, shared by every thread, and is
+ * never cleared between boards: scores are sound bounds whatever board
+ * produced them. Off (D = 0) unless position_cache_configure_c is called.
+ *
+ * Key, for the spatial transform giving the smallest value (cells in
+ * transformed order):
+ *   bits 48-63  empty-cell mask
+ *   bits 32-47  per cell: empty ? compatible with the last tile : owned by P1
+ *   bits  0-27  compatibility of each pair of empty cells
+ * That fits 64 bits for up to 8 empty cells, so D >= 8.
+ *
+ * The key is scrambled by an invertible 64-bit mix; the high bucket_bits
+ * select a bucket of 8 entries and the rest is stored as the tag, so a tag
+ * match is an exact key match. Entry: tag << 3 | value code (0 = empty
+ * slot). A full bucket overwrites the slot picked by the tag.
+ */
+#define PC_MIN_DEPTH        8
+#define PC_BUCKET_SLOTS     8
+#define PC_MIN_BUCKET_BITS  11   /* 128 KB */
+#define PC_MAX_BUCKET_BITS  30   /* 64 GB  */
+
+typedef struct {
+    uint64_t slot[PC_BUCKET_SLOTS];
+} PCBucket;
+
+static struct {
+    PCBucket *buckets;
+    int       bucket_bits;
+    int       depth;        /* tiles down at cached positions, 0 = off */
+} position_cache;
 
+/* PC_CELL_IMAGE[t][half][byte]: mask bits of one byte moved to their cells
+ * under TRANSFORM_MAPS[t], so a mask is transformed with two loads */
+static uint16_t PC_CELL_IMAGE[8][2][256];
+
+__attribute__((constructor))
+static void init_position_cache_images(void) {
+    for (int t = 0; t < 8; t++)
         for (int i = 0; i < 16; i++) {
-            if (i == p1_move) continue;
-            if (plants[i] == tp || poems[i] == ts) {
-                uint16_t p2_mask = (uint16_t)(1 << i);
-                MiniResult r = minimax(plants, poems, p1_mask, p2_mask,
-                                       i, 1, NEG_INF, INF, 2, tt);
-                if (r.score < p2_best_score) {
-                    p2_best_score = r.score;
-                    p2_best_move  = i;
-                    p2_best_out   = r.outcome;
-                }
+            int c = TRANSFORM_MAPS[t][i];
+            for (int byte = 0; byte < 256; byte++)
+                if (byte >> (c & 7) & 1)
+                    PC_CELL_IMAGE[t][c >> 3][byte] |= (uint16_t)(1 << i);
+        }
+}
+
+static uint64_t pc_key(const uint16_t *compat, uint16_t p1_mask, uint16_t empty, int last_move) {
+    uint64_t best = UINT64_MAX;
+    uint16_t reach = compat[last_move];
+    for (int t = 0; t < 8; t++) {
+        uint64_t key = (uint64_t)(PC_CELL_IMAGE[t][0][empty & 0xFF] |
+                                  PC_CELL_IMAGE[t][1][empty >> 8]) << 48;
+        if (key > best) continue;
+
+        const uint8_t *map = TRANSFORM_MAPS[t];
+        int cells[16], n = 0;
+        for (int i = 0; i < 16; i++) {
+            int c = map[i];
+            if (empty >> c & 1) {
+                key |= (uint64_t)(reach >> c & 1) << (32 + i);
+                cells[n++] = c;
+            } else {
+                key |= (uint64_t)(p1_mask >> c & 1) << (32 + i);
             }
         }
+        if (key > best) continue;
 
-        out->p2_moves[oi]    = (int8_t)p2_best_move;
-        out->p2_scores[oi]   = (int8_t)p2_best_score;
-        out->p2_outcomes[oi] = p2_best_out;
+        int shift = 0;
+        for (int a = 1; a < n; a++) {
+            uint16_t adj = compat[cells[a]];
+            for (int b = 0; b < a; b++)
+                key |= (uint64_t)(adj >> cells[b] & 1) << shift++;
+        }
+        if (key < best) best = key;
     }
+
+    /* splitmix64 finalizer: a bijection, so distinct keys never collide */
+    best ^= best >> 30;
+    best *= 0xBF58476D1CE4E5B9ULL;
+    best ^= best >> 27;
+    best *= 0x94D049BB133111EBULL;
+    best ^= best >> 31;
+    return best;
 }
 
+static inline int pc_lookup(uint64_t mixed, int *lo, int *hi) {
+    STAT(thread_stats.pc_probes++);
+    const PCBucket *b = &position_cache.buckets[mixed >> (64 - position_cache.bucket_bits)];
+    uint64_t tag = mixed & (UINT64_MAX >> position_cache.bucket_bits);
+    for (int s = 0; s < PC_BUCKET_SLOTS; s++) {
+        uint64_t e = __atomic_load_n(&b->slot[s], __ATOMIC_RELAXED);
+        if (e == 0) return 0;  /* slots fill front to back */
+        if (e >> 3 == tag) {
+            *lo = TT_CODE_LO[e & 7];
+            *hi = TT_CODE_HI[e & 7];
+            STAT(thread_stats.pc_hits++);
+            return 1;
+        }
+    }
+    return 0;
+}
 
-/* ================================================================
- * Board canonicalization
+static inline void pc_store(uint64_t mixed, int lo, int hi) {
+    PCBucket *b = &position_cache.buckets[mixed >> (64 - position_cache.bucket_bits)];
+    uint64_t tag = mixed & (UINT64_MAX >> position_cache.bucket_bits);
+    uint64_t e = tag << 3 | tt_encode_value(lo, hi);
+    for (int s = 0; s < PC_BUCKET_SLOTS; s++) {
+        uint64_t old = __atomic_load_n(&b->slot[s], __ATOMIC_RELAXED);
+        if (old == 0 || old >> 3 == tag) {
+            __atomic_store_n(&b->slot[s], e, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    __atomic_store_n(&b->slot[tag % PC_BUCKET_SLOTS], e, __ATOMIC_RELAXED);
+}
+
+/* ---- Check win ---- */
+/*
+ * WIN_OUTCOME[mask] = outcome index of the first pattern in WIN_PATTERNS
+ * order contained in mask, or -1. Filled once when the library is loaded,
+ * so terminal detection is a single 64 KB table load per node.
  *
- * Finds the lexicographically smallest board among all equivalences:
- *   8 spatial symmetries × 24 plant perms × 24 poem perms × 2 swap
- *   = 9,216 total transforms
- * ================================================================ */
+ * THREAT_CELLS[mask] = cells that would complete a pattern if added to
+ * mask (used by move ordering).
+ */
+static int8_t   WIN_OUTCOME[1 << 16];
+static uint16_t THREAT_CELLS[1 << 16];
 
-/* 8 spatial transforms: transform_maps[t][i] = source index for position i */
-static const int TRANSFORM_MAPS[8][16] = {
-    /* Identity */
-    { 0, 1, 2, 3,  4, 5, 6, 7,  8, 9,10,11, 12,13,14,15},
-    /* 90° CW rotation */
-    {12, 8, 4, 0, 13, 9, 5, 1, 14,10, 6, 2, 15,11, 7, 3},
-    /* 180° rotation */
-    {15,14,13,12, 11,10, 9, 8,  7, 6, 5, 4,  3, 2, 1, 0},
-    /* 270° CW rotation */
-    { 3, 7,11,15,  2, 6,10,14,  1, 5, 9,13,  0, 4, 8,12},
-    /* Horizontal reflection (flip rows) */
-    {12,13,14,15,  8, 9,10,11,  4, 5, 6, 7,  0, 1, 2, 3},
-    /* Vertical reflection (flip cols) */
-    { 3, 2, 1, 0,  7, 6, 5, 4, 11,10, 9, 8, 15,14,13,12},
-    /* Main diagonal transpose */
-    { 0, 4, 8,12,  1, 5, 9,13,  2, 6,10,14,  3, 7,11,15},
-    /* Anti-diagonal transpose */
-    {15,11, 7, 3, 14,10, 6, 2, 13, 9, 5, 1, 12, 8, 4, 0},
-};
+__attribute__((constructor))
+static void init_win_outcome(void) {
+    for (uint32_t mask = 0; mask < (1u << 16); mask++) {
+        int8_t out = -1;
+        uint16_t threats = 0;
+        for (int i = 0; i < NUM_WIN_PATTERNS; i++) {
+            uint16_t missing = WIN_PATTERNS[i].mask & (uint16_t)~mask;
+            if (missing == 0 && out < 0)
+                out = WIN_PATTERNS[i].outcome;
+            if (__builtin_popcount(missing) == 1)
+                threats |= missing;
+        }
+        WIN_OUTCOME[mask] = out;
+        THREAT_CELLS[mask] = threats;
+    }
+}
 
-/* All 24 permutations of {0,1,2,3} */
-static const int LABEL_PERMS[24][4] = {
-    {0,1,2,3},{0,1,3,2},{0,2,1,3},{0,2,3,1},{0,3,1,2},{0,3,2,1},
-    {1,0,2,3},{1,0,3,2},{1,2,0,3},{1,2,3,0},{1,3,0,2},{1,3,2,0},
-    {2,0,1,3},{2,0,3,1},{2,1,0,3},{2,1,3,0},{2,3,0,1},{2,3,1,0},
-    {3,0,1,2},{3,0,2,1},{3,1,0,2},{3,1,2,0},{3,2,0,1},{3,2,1,0},
-};
-#define NUM_LABEL_PERMS 24
+static inline int check_win(uint16_t mask) {
+    return WIN_OUTCOME[mask];
+}
 
 
+/* ---- Compatibility bitboards ---- */
 /*
- * Compare two boards lexicographically.
- * Board = (plants[0], poems[0], plants[1], poems[1], ...)
- * Returns: <0 if a<b, 0 if a==b, >0 if a>b
+ * compat[i] = set of cells whose tile shares a plant or poem with cell i
+ * (including i itself). The board is fixed for a whole solve, so the legal
+ * replies to a move on cell i are simply compat[i] & ~taken.
  */
-static inline int board_cmp(const int8_t *ap, const int8_t *as,
-                            const int8_t *bp, const int8_t *bs) {
+static void build_compat(const int8_t *plants, const int8_t *poems, uint16_t *compat) {
     for (int i = 0; i < 16; i++) {
-        if (ap[i] != bp[i]) return ap[i] - bp[i];
-        if (as[i] != bs[i]) return as[i] - bs[i];
+        uint16_t m = 0;
+        for (int j = 0; j < 16; j++)
+            m |= (uint16_t)((plants[j] == plants[i] || poems[j] == poems[i]) << j);
+        compat[i] = m;
     }
-    return 0;
 }
 
 
+/* ---- Move ordering ---- */
 /*
- * canonicalize_board_c - Find the canonical (lex-smallest) board.
- *
- * Args:
- *   plants[16], poems[16]: input board
- *   out_plants[16], out_poems[16]: canonical board (output)
+ * Look for a legal move that wins on the spot, either completing one of
+ * the mover's patterns or leaving the opponent without a reply (only before
+ * the last ply; a full board is a draw). Checks moves in index order and
+ * prefers a pattern win on the same cell, matching what the child node
+ * would report. Returns the outcome index (and sets *win_move) or -1.
  */
-void canonicalize_board_c(
-    const int8_t *plants,
-    const int8_t *poems,
-    int8_t *out_plants,
-    int8_t *out_poems
-) {
-    /* Start with input as best */
-    memcpy(out_plants, plants, 16);
-    memcpy(out_poems,  poems,  16);
+static inline int find_immediate_win(const uint16_t *compat, uint16_t moves,
+                                     uint16_t taken, uint16_t mover_mask,
+                                     int next_depth, int *win_move) {
+    uint16_t winning = moves & THREAT_CELLS[mover_mask];
+    if (next_depth < 16) {
+        for (uint16_t rest = moves & (uint16_t)~winning; rest; rest &= rest - 1) {
+            int move = __builtin_ctz(rest);
+            if ((compat[move] & (uint16_t)~(taken | (1 << move))) == 0)
+                winning |= (uint16_t)(1 << move);
+        }
+    }
+    if (winning == 0) return -1;
 
-    int8_t cp[16], cs[16]; /* candidate plants/poems */
+    int move = __builtin_ctz(winning);
+    int win = check_win(mover_mask | (uint16_t)(1 << move));
+    *win_move = move;
+    return win >= 0 ? win : OUT_BLOCKADE;
+}
 
-    for (int t = 0; t < 8; t++) {
-        /* Apply spatial transform */
-        int8_t sp[16], ss[16];
+/*
+ * Split the (non-winning) legal moves into search-order classes:
+ *   [0] the TT's best move from an earlier search of this position
+ *   [1] moves onto a cell the opponent needs to complete a pattern
+ *   [2] quiet moves
+ *   [3] moves that let the opponent complete a pattern on the next ply
+ */
+#define NUM_MOVE_CLASSES 4
+
+static inline void order_moves(const uint16_t *compat, uint16_t moves,
+                               uint16_t taken, uint16_t opp_mask, int hint,
+                               uint16_t classes[NUM_MOVE_CLASSES]) {
+    /* Empty cells that would complete one of the opponent's patterns */
+    uint16_t threats = THREAT_CELLS[opp_mask] & (uint16_t)~taken;
+    uint16_t losing = 0;
+    if (threats) {
+        for (uint16_t rest = moves; rest; rest &= rest - 1) {
+            uint16_t bit = rest & (uint16_t)-rest;
+            int move = __builtin_ctz(rest);
+            if (compat[move] & (uint16_t)~(taken | bit) & threats)
+                losing |= bit;
+        }
+    }
+
+    uint16_t first = hint >= 0 ? moves & (uint16_t)(1 << hint) : 0;
+    moves &= (uint16_t)~first;
+
+    classes[0] = first;
+    classes[1] = moves & threats & (uint16_t)~losing;
+    classes[2] = moves & (uint16_t)~threats & (uint16_t)~losing;
+    classes[3] = moves & losing;
+}
+
+
+/* ---- Endgame kernel ---- */
+/*
+ * Once ENDGAME_DEPTH tiles are down, endgame() takes over: plain fail-soft
+ * alpha-beta over the empty-cell mask, with no TT and no move ordering
+ * beyond taking a win on the spot. A TT probe is a cache miss, and the
+ * subtrees this deep are cheaper to search again than to look up (each
+ * tile matches at most 6 others, so a node has at most 6 replies and
+ * usually 2-3). It also keeps most of the stores out of the TT, leaving
+ * it to the positions near the root that are expensive to recompute.
+ *
+ * No memo is kept either: the empty set does not fix the position, since
+ * who owns each taken cell still matters. ENDGAME_DEPTH was tuned on the
+ * bench/ corpus; 5-8 perform about the same, 11 is ~2x slower. The one
+ * exception is the optional shared position cache, probed at its depth.
+ */
+#define ENDGAME_DEPTH 7
+
+static int endgame(const uint16_t *compat, uint16_t p1_mask, uint16_t p2_mask,
+                   uint16_t empty, int last_move, int is_p1_turn, int alpha, int beta) {
+    STAT(thread_stats.nodes++; thread_stats.endgame_nodes++);
+    STAT(if (16u - (uint64_t)__builtin_popcount(empty) > thread_stats.max_depth)
+             thread_stats.max_depth = 16u - (uint64_t)__builtin_popcount(empty));
+    TRACE(trace_node(16 - __builtin_popcount(empty)));
+
+    int mover_wins = is_p1_turn ? P1_WINS : P1_LOSES;
+    if (check_win(is_p1_turn ? p2_mask : p1_mask) >= 0) return -mover_wins;
+    if (empty == 0) return DRAW_SCORE;
+
+    uint16_t moves = compat[last_move] & empty;
+    TRACE(thread_trace.reply_nodes[__builtin_popcount(moves)]++);
+    if (moves == 0) return -mover_wins;
+
+    /* A move that completes a pattern, or on the last cell a full-board draw */
+    uint16_t mover_mask = is_p1_turn ? p1_mask : p2_mask;
+    if (moves & THREAT_CELLS[mover_mask]) return mover_wins;
+    if ((empty & (empty - 1)) == 0) return DRAW_SCORE;
+
+    /* Blockade: a move that leaves the opponent no reply */
+    for (uint16_t rest = moves; rest; rest &= rest - 1) {
+        uint16_t bit = rest & (uint16_t)-rest;
+        if ((compat[__builtin_ctz(rest)] & empty & (uint16_t)~bit) == 0)
+            return mover_wins;
+    }
+
+    /* Shared position cache, as the TT in minimax */
+    uint64_t key = 0;
+    int known_lo = P1_LOSES, known_hi = P1_WINS;
+    if (16 - __builtin_popcount(empty) == position_cache.depth) {
+        key = pc_key(compat, p1_mask, empty, last_move);
+        if (pc_lookup(key, &known_lo, &known_hi)) {
+            if (known_lo == known_hi || known_lo >= beta) return known_lo;
+            if (known_hi <= alpha) return known_hi;
+            if (known_lo > alpha) alpha = known_lo;
+            if (known_hi < beta)  beta  = known_hi;
+        }
+    }
+    int alpha0 = alpha, beta0 = beta;
+
+    int best_score = is_p1_turn ? NEG_INF : INF;
+    for (uint16_t rest = moves; rest; rest &= rest - 1) {
+        int move = __builtin_ctz(rest);
+        uint16_t bit = (uint16_t)(1 << move);
+        if (is_p1_turn) {
+            int s = endgame(compat, p1_mask | bit, p2_mask, empty & (uint16_t)~bit,
+                            move, 0, alpha, beta);
+            if (s > best_score) best_score = s;
+            if (s > alpha) alpha = s;
+        } else {
+            int s = endgame(compat, p1_mask, p2_mask | bit, empty & (uint16_t)~bit,
+                            move, 1, alpha, beta);
+            if (s < best_score) best_score = s;
+            if (s < beta) beta = s;
+        }
+        if (beta <= alpha) {
+            STAT(thread_stats.cutoffs++);
+            break;
+        }
+    }
+
+    if (key) {
+        int lo = known_lo, hi = known_hi;
+        if (best_score <= alpha0) {
+            hi = best_score;
+        } else if (best_score >= beta0) {
+            lo = best_score;
+        } else {
+            lo = hi = best_score;
+        }
+        if (lo != P1_LOSES || hi != P1_WINS)
+            pc_store(key, lo, hi);
+    }
+    return best_score;
+}
+
+
+/* ---- Core minimax ---- */
+/*
+ * Fail-soft alpha-beta returning the position's score from P1's view.
+ * Only the score is searched for; how the game ends along the optimal line
+ * is recovered afterwards by pv_walk.
+ */
+static int minimax(
+    const uint16_t *compat, /* compat[16], see build_compat */
+    uint16_t p1_mask,
+    uint16_t p2_mask,
+    int last_move,
+    int is_p1_turn,
+    int alpha,
+    int beta,
+    int depth,
+    TTable *tt
+) {
+    if (depth >= ENDGAME_DEPTH)
+        return endgame(compat, p1_mask, p2_mask, (uint16_t)~(p1_mask | p2_mask),
+                       last_move, is_p1_turn, alpha, beta);
+
+    STAT(thread_stats.nodes++);
+    STAT(if ((uint64_t)depth > thread_stats.max_depth) thread_stats.max_depth = (uint64_t)depth);
+    TRACE(trace_node(depth));
+
+    /* TT lookup: exact entries and cutting bounds return immediately,
+     * other bounds narrow the window */
+    uint64_t key = tt_mix(p1_mask, p2_mask, last_move);
+    int known_lo = P1_LOSES;
+    int known_hi = P1_WINS;
+    int hint = -1;
+    TTHit hit;
+    int found = tt_lookup(tt, key, &hit);
+    TRACE(trace_probe(depth, found));
+    if (found) {
+        if (hit.lo == hit.hi || hit.lo >= beta) return hit.lo;
+        if (hit.hi <= alpha) return hit.hi;
+        known_lo = hit.lo;
+        known_hi = hit.hi;
+        hint     = hit.best_move;
+        if (known_lo > alpha) alpha = known_lo;
+        if (known_hi < beta)  beta  = known_hi;
+    }
+
+    /* 1. Check if previous move won */
+    uint16_t prev_mask = is_p1_turn ? p2_mask : p1_mask;
+    if (check_win(prev_mask) >= 0) {
+        int score = is_p1_turn ? P1_LOSES : P1_WINS;
+        tt_store(tt, key, score, score, 0);
+        return score;
+    }
+
+    /* 2. Full board = draw */
+    if (depth == 16) {
+        tt_store(tt, key, DRAW_SCORE, DRAW_SCORE, 0);
+        return DRAW_SCORE;
+    }
+
+    /* 3. Get legal moves (match plant or poem of last tile) */
+    uint16_t taken = p1_mask | p2_mask;
+    uint16_t moves = compat[last_move] & (uint16_t)~taken;
+    TRACE(thread_trace.reply_nodes[__builtin_popcount(moves)]++);
+
+    /* 4. Blockade */
+    if (moves == 0) {
+        int score = is_p1_turn ? P1_LOSES : P1_WINS;
+        tt_store(tt, key, score, score, 0);
+        return score;
+    }
+
+    /* 5. Immediate win: no need to search any child */
+    int next_depth = depth + 1;
+    uint16_t mover_mask = is_p1_turn ? p1_mask : p2_mask;
+    int win_move;
+    if (find_immediate_win(compat, moves, taken, mover_mask, next_depth, &win_move) >= 0) {
+        int score = is_p1_turn ? P1_WINS : P1_LOSES;
+        tt_store(tt, key, score, score, win_move);
+        return score;
+    }
+
+    /* 6. Recurse, most forcing moves first */
+    uint16_t classes[NUM_MOVE_CLASSES];
+    order_moves(compat, moves, taken, prev_mask, hint, classes);
+    int best_move = hint >= 0 ? hint : __builtin_ctz(moves);
+    int alpha0 = alpha;
+    int beta0  = beta;
+    int best_score;
+#ifdef NIYA_STATS
+    int searched = 0;
+#endif
+#ifdef NIYA_TRACE
+    uint64_t trace_late = 0;   /* nodes under P2 replies that did not cut off */
+#endif
+
+    if (is_p1_turn) {
+        best_score = NEG_INF;
+        for (int c = 0; c < NUM_MOVE_CLASSES && alpha < beta; c++) {
+            for (uint16_t rest = classes[c]; rest; rest &= rest - 1) {
+                int move = __builtin_ctz(rest);
+                int s = minimax(compat, p1_mask | (uint16_t)(1 << move), p2_mask,
+                                move, 0, alpha, beta, next_depth, tt);
+                if (s > best_score) {
+                    best_score = s;
+                    best_move  = move;
+                }
+                if (s > alpha) alpha = s;
+                STAT(searched++);
+                if (beta <= alpha) {
+                    STAT(thread_stats.cutoffs++; thread_stats.first_child_cutoffs += searched == 1);
+                    break;
+                }
+            }
+        }
+    } else {
+        best_score = INF;
+        for (int c = 0; c < NUM_MOVE_CLASSES && alpha < beta; c++) {
+            for (uint16_t rest = classes[c]; rest; rest &= rest - 1) {
+                int move = __builtin_ctz(rest);
+#ifdef NIYA_TRACE
+                TraceMark trace_at = trace_mark();
+#endif
+                int s = minimax(compat, p1_mask, p2_mask | (uint16_t)(1 << move),
+                                move, 1, alpha, beta, next_depth, tt);
+                if (s < best_score) {
+                    best_score = s;
+                    best_move  = move;
+                }
+                if (s < beta) beta = s;
+                STAT(searched++);
+                if (beta <= alpha) {
+                    STAT(thread_stats.cutoffs++; thread_stats.first_child_cutoffs += searched == 1);
+                    TRACE(thread_trace.p2_late_nodes += trace_late);
+                    break;
+                }
+                TRACE(trace_late += trace_failed_reply(trace_at));
+            }
+        }
+    }
+
+    /* Fail-low gives an upper bound, fail-high a lower bound. A window that
+     * already excluded every score (e.g. alpha = P1_WINS) proves nothing. */
+    int lo = known_lo, hi = known_hi;
+    if (best_score <= alpha0) {
+        hi = best_score;
+    } else if (best_score >= beta0) {
+        lo = best_score;
+    } else {
+        lo = hi = best_score;
+    }
+    if (lo != P1_LOSES || hi != P1_WINS)
+        tt_store(tt, key, lo, hi, best_move);
+    return best_score;
+}
+
+
+/* ---- Proof-number search (df-pn) ---- */
+/*
+ * An alternative engine for the root driver's zero-window tests: instead
+ * of depth-first alpha-beta, depth-first proof-number search (Nagai's
+ * df-pn) answers "is the value >= target?" best-first, always expanding
+ * the child that looks cheapest to prove or disprove. Branching varies a
+ * lot in Niya (compatibility sets shrink fast), which is where proof
+ * numbers do best.
+ *
+ * Numbers are kept from the mover's view: phi is the cost of showing the
+ * mover gets the answer it wants (P1: value >= target, P2: value <
+ * target), delta the cost of refuting that, so for every node
+ *   phi = min over children of delta,  delta = sum over children of phi.
+ * A child's delta starts as its number of legal replies (df-pn+ style),
+ * and the second-best child bound uses the 1 + 1/2 trick to cut down on
+ * re-expansions. Won and lost nodes are (0, INF) and (INF, 0).
+ *
+ * Once DFPN_ENDGAME_DEPTH tiles are down the subtree is settled by one
+ * zero-window endgame() call, which is far cheaper than keeping proof
+ * numbers for it. 8 was tuned on the bench/ corpus: a deeper handoff
+ * expands fewer nodes, but each df-pn node probes the table once per
+ * child, so 10 and beyond are 2-4x slower.
+ *
+ * Proof numbers live in their own per-thread table, 4 entries of (key,
+ * phi, delta) per 64-byte bucket, with the board generation and the
+ * target in the key so nothing is cleared between boards or tests. When a
+ * bucket is full the entry with the most tiles down is replaced.
+ */
+#define DFPN_INF           (UINT32_MAX / 2)
+#define DFPN_ENDGAME_DEPTH 8
+#define DFPN_BUCKET_SLOTS  4
+#define DFPN_GEN_SHIFT     37
+#define DFPN_POS_MASK      (((uint64_t)1 << DFPN_GEN_SHIFT) - 1)
+
+typedef struct {
+    uint64_t key;        /* gen << 37 | target_bit << 36 | last << 32 | p2 << 16 | p1 */
+    uint32_t phi, delta;
+} DfpnEntry;
+
+typedef struct {
+    DfpnEntry slot[DFPN_BUCKET_SLOTS];
+} DfpnBucket;
+
+struct DfpnTable {
+    DfpnBucket *buckets;
+    uint64_t    gen;          /* current generation (one per solved board) */
+    int         bucket_bits;
+    int         config_bits;  /* tt_config_bucket_bits it was mapped for */
+};
+
+typedef struct {
+    const uint16_t *compat;
+    DfpnTable      *table;
+    int             target;
+} Dfpn;
+
+/*
+ * This thread's own table at the TT's configured size (or the largest
+ * smaller one that can be mapped), ready for the next board. NULL if not
+ * even the smallest can, and the root tests fall back to alpha-beta.
+ */
+static DfpnTable *dfpn_begin_board(void) {
+    static __thread DfpnTable dt = { NULL, 0, 0, 0 };
+    int bits = __atomic_load_n(&tt_config_bucket_bits, __ATOMIC_RELAXED);
+    if (dt.buckets && dt.config_bits != bits) {
+        table_free(dt.buckets, sizeof(DfpnBucket) << dt.bucket_bits);
+        dt.buckets = NULL;
+    }
+    if (!dt.buckets) {
+        dt.config_bits = bits;
+        int pages;
+        dt.buckets = (DfpnBucket *)table_alloc_fit(sizeof(DfpnBucket), &bits,
+                                                   TT_MIN_BUCKET_BITS, &pages);
+        if (!dt.buckets) return NULL;
+        memset(dt.buckets, 0, sizeof(DfpnBucket) << bits);
+        dt.bucket_bits = bits;
+        dt.gen = 0;
+    }
+    if (++dt.gen >> (64 - DFPN_GEN_SHIFT)) {
+        memset(dt.buckets, 0, sizeof(DfpnBucket) << dt.bucket_bits);
+        dt.gen = 1;
+    }
+    return &dt;
+}
+
+static inline uint64_t dfpn_key(const Dfpn *s, uint16_t p1, uint16_t p2, int last) {
+    return (s->table->gen << DFPN_GEN_SHIFT) | ((uint64_t)(s->target > DRAW_SCORE) << 36) |
+           ((uint64_t)last << 32) | ((uint64_t)p2 << 16) | p1;
+}
+
+static inline DfpnBucket *dfpn_bucket(const Dfpn *s, uint64_t key) {
+    uint64_t h = (key & DFPN_POS_MASK) * 0x9E3779B97F4A7C15ULL;
+    return &s->table->buckets[h >> (64 - s->table->bucket_bits)];
+}
+
+static inline int dfpn_lookup(const Dfpn *s, uint64_t key, uint32_t *phi, uint32_t *delta) {
+    STAT(thread_stats.tt_probes++);
+    const DfpnBucket *b = dfpn_bucket(s, key);
+    for (int i = 0; i < DFPN_BUCKET_SLOTS; i++) {
+        if (b->slot[i].key == key) {
+            *phi   = b->slot[i].phi;
+            *delta = b->slot[i].delta;
+            STAT(thread_stats.tt_hits++);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline void dfpn_store(const Dfpn *s, uint64_t key, uint32_t phi, uint32_t delta) {
+    STAT(thread_stats.tt_stores++);
+    DfpnBucket *b = dfpn_bucket(s, key);
+    uint64_t gen = s->table->gen;
+    int victim = 0, victim_depth = -1;
+    for (int i = 0; i < DFPN_BUCKET_SLOTS; i++) {
+        uint64_t old = b->slot[i].key;
+        if (old == key) {
+            victim = i;
+            victim_depth = -1;
+            break;
+        }
+        /* Stale or empty slots go first, then the smallest subtree */
+        int d = old >> DFPN_GEN_SHIFT != gen ? 17 : __builtin_popcount((uint32_t)old);
+        if (d > victim_depth) {
+            victim = i;
+            victim_depth = d;
+        }
+    }
+    STAT(if (victim_depth >= 0 && victim_depth <= 16) thread_stats.tt_evictions++);
+    b->slot[victim] = (DfpnEntry){ key, phi, delta };
+}
+
+/* Does the mover get the answer it wants from a position of value `score`? */
+static inline int dfpn_mover_wins(const Dfpn *s, int is_p1_turn, int score) {
+    return is_p1_turn ? score >= s->target : score < s->target;
+}
+
+/*
+ * Expand a position until its phi reaches th_phi or its delta reaches
+ * th_delta, leaving the final numbers in *phi_out / *delta_out.
+ */
+static void dfpn_mid(const Dfpn *s, uint16_t p1_mask, uint16_t p2_mask, int last_move,
+                     int is_p1_turn, int depth, uint32_t th_phi, uint32_t th_delta,
+                     uint32_t *phi_out, uint32_t *delta_out) {
+    STAT(thread_stats.nodes++);
+    STAT(if ((uint64_t)depth > thread_stats.max_depth) thread_stats.max_depth = (uint64_t)depth);
+    TRACE(trace_node(depth));
+
+    const uint16_t *compat = s->compat;
+    uint16_t taken = p1_mask | p2_mask;
+    uint16_t moves = compat[last_move] & (uint16_t)~taken;
+    TRACE(thread_trace.reply_nodes[__builtin_popcount(moves)]++);
+    uint16_t mover_mask = is_p1_turn ? p1_mask : p2_mask;
+    int mover_score = is_p1_turn ? P1_WINS : P1_LOSES;
+    int win_move, score;
+
+    if (check_win(is_p1_turn ? p2_mask : p1_mask) >= 0) {
+        score = -mover_score;
+    } else if (depth == 16) {
+        score = DRAW_SCORE;
+    } else if (moves == 0) {
+        score = -mover_score;
+    } else if (find_immediate_win(compat, moves, taken, mover_mask, depth + 1, &win_move) >= 0) {
+        score = mover_score;
+    } else if (depth >= DFPN_ENDGAME_DEPTH) {
+        score = endgame(compat, p1_mask, p2_mask, (uint16_t)~taken, last_move, is_p1_turn,
+                        s->target - 1, s->target) >= s->target ? P1_WINS : P1_LOSES;
+    } else {
+        goto expand;
+    }
+    *phi_out   = dfpn_mover_wins(s, is_p1_turn, score) ? 0 : DFPN_INF;
+    *delta_out = *phi_out ? 0 : DFPN_INF;
+    return;
+
+expand:;
+    int      child_move[16], n = 0;
+    uint64_t child_key[16];
+    uint32_t child_phi[16], child_delta[16];
+    for (uint16_t rest = moves; rest; rest &= rest - 1) {
+        int move = __builtin_ctz(rest);
+        uint16_t bit = (uint16_t)(1 << move);
+        uint16_t c1 = is_p1_turn ? p1_mask | bit : p1_mask;
+        uint16_t c2 = is_p1_turn ? p2_mask : p2_mask | bit;
+        child_move[n] = move;
+        child_key[n]  = dfpn_key(s, c1, c2, move);
+        int found = dfpn_lookup(s, child_key[n], &child_phi[n], &child_delta[n]);
+        TRACE(trace_probe(depth + 1, found));
+        if (!found) {
+            int replies = __builtin_popcount(compat[move] & (uint16_t)~(taken | bit));
+            child_phi[n]   = 1;
+            child_delta[n] = replies ? (uint32_t)replies : 1;
+        }
+        n++;
+    }
+
+    uint32_t phi, delta;
+    for (;;) {
+        /* phi = min child delta (best child c, runner-up delta2), delta = sum child phi */
+        int c = 0;
+        uint32_t delta2 = DFPN_INF;
+        uint64_t sum = 0;
+        int lost_child = 0;
+        for (int i = 0; i < n; i++) {
+            if (child_delta[i] < child_delta[c]) {
+                delta2 = child_delta[c];
+                c = i;
+            } else if (i != c && child_delta[i] < delta2) {
+                delta2 = child_delta[i];
+            }
+            sum += child_phi[i];
+            lost_child |= child_phi[i] >= DFPN_INF;
+        }
+        phi   = child_delta[c];
+        delta = lost_child ? DFPN_INF : sum < DFPN_INF ? (uint32_t)sum : DFPN_INF - 1;
+        if (phi >= th_phi || delta >= th_delta) break;
+
+        uint64_t c_th_phi = (uint64_t)th_delta - delta + child_phi[c];
+        uint64_t c_th_delta = delta2 >= DFPN_INF ? DFPN_INF : delta2 + delta2 / 2 + 1;
+        if (c_th_delta > th_phi) c_th_delta = th_phi;
+        if (c_th_phi > DFPN_INF) c_th_phi = DFPN_INF;
+
+        int move = child_move[c];
+        uint16_t bit = (uint16_t)(1 << move);
+        dfpn_mid(s, is_p1_turn ? p1_mask | bit : p1_mask, is_p1_turn ? p2_mask : p2_mask | bit,
+                 move, !is_p1_turn, depth + 1, (uint32_t)c_th_phi, (uint32_t)c_th_delta,
+                 &child_phi[c], &child_delta[c]);
+        dfpn_store(s, child_key[c], child_phi[c], child_delta[c]);
+    }
+    *phi_out   = phi;
+    *delta_out = delta;
+}
+
+/* df-pn counterpart of minimax's zero-window test: is the value >= target? */
+static int dfpn_at_least(const uint16_t *compat, DfpnTable *table, uint16_t p1_mask,
+                         uint16_t p2_mask, int last_move, int is_p1_turn, int target, int depth) {
+    Dfpn s = { compat, table, target };
+    uint32_t phi, delta;
+    uint64_t key = dfpn_key(&s, p1_mask, p2_mask, last_move);
+    if (!dfpn_lookup(&s, key, &phi, &delta) || (phi && delta)) {
+        dfpn_mid(&s, p1_mask, p2_mask, last_move, is_p1_turn, depth,
+                 DFPN_INF, DFPN_INF, &phi, &delta);
+        dfpn_store(&s, key, phi, delta);
+    }
+    return (phi == 0) == (is_p1_turn != 0);
+}
+
+
+/* ---- Board kernels ---- */
+/*
+ * A board packed as 16 tile bytes, (plant << 2) | poem. Lexicographic order
+ * on packed bytes is the (plant, poem) order board_cmp uses, so the
+ * canonicalizer and the automorphism search work on this form:
+ *   tiles_permute    out[i] = in[map[i]]           (pshufb / tbl)
+ *   tiles_swap       exchange plant and poem
+ *   tiles_normalize  relabel plants and poems in order of first appearance
+ *                    (one 16-entry tile table lookup)
+ *   tiles_cmp        sign of the first differing byte
+ *   tiles_candidate  canonicalizer inner step: permute, normalize, and
+ *                    keep the result in best if it is smaller
+ */
+static inline void tiles_pack(const int8_t *plants, const int8_t *poems, uint8_t *out) {
+    for (int i = 0; i < 16; i++)
+        out[i] = (uint8_t)((plants[i] << 2) | poems[i]);
+}
+
+static inline void tiles_unpack(const uint8_t *tiles, int8_t *plants, int8_t *poems) {
+    for (int i = 0; i < 16; i++) {
+        plants[i] = (int8_t)(tiles[i] >> 2);
+        poems[i]  = (int8_t)(tiles[i] & 3);
+    }
+}
+
+/* New label of each old label, given where each label first appears */
+static inline void first_appearance_ranks(const int *first, uint8_t *rank) {
+    for (int a = 0; a < 4; a++)
+        rank[a] = (uint8_t)((first[0] < first[a]) + (first[1] < first[a]) +
+                            (first[2] < first[a]) + (first[3] < first[a]));
+}
+
+#if defined(NIYA_SIMD_SSSE3)
+
+static inline void tiles_permute(const uint8_t *in, const uint8_t *map, uint8_t *out) {
+    __m128i v = _mm_loadu_si128((const __m128i *)in);
+    _mm_storeu_si128((__m128i *)out,
+                     _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i *)map)));
+}
+
+static inline void tiles_swap(const uint8_t *in, uint8_t *out) {
+    const __m128i three = _mm_set1_epi8(3);
+    __m128i v = _mm_loadu_si128((const __m128i *)in);
+    __m128i poem_hi  = _mm_slli_epi16(_mm_and_si128(v, three), 2);
+    __m128i plant_lo = _mm_and_si128(_mm_srli_epi16(v, 2), three);
+    _mm_storeu_si128((__m128i *)out, _mm_or_si128(poem_hi, plant_lo));
+}
+
+static inline void tiles_normalize(const uint8_t *in, uint8_t *out) {
+    const __m128i three = _mm_set1_epi8(3);
+    __m128i v      = _mm_loadu_si128((const __m128i *)in);
+    __m128i plants = _mm_and_si128(_mm_srli_epi16(v, 2), three);
+    __m128i poems  = _mm_and_si128(v, three);
+    int first_plant[4], first_poem[4];
+    for (int a = 0; a < 4; a++) {
+        __m128i label = _mm_set1_epi8((char)a);
+        first_plant[a] = __builtin_ctz(_mm_movemask_epi8(_mm_cmpeq_epi8(plants, label)) | 0x10000);
+        first_poem[a]  = __builtin_ctz(_mm_movemask_epi8(_mm_cmpeq_epi8(poems,  label)) | 0x10000);
+    }
+    uint8_t rank_plant[4], rank_poem[4];
+    first_appearance_ranks(first_plant, rank_plant);
+    first_appearance_ranks(first_poem,  rank_poem);
+
+    /* table[tile] = rank_plant[tile >> 2] << 2 | rank_poem[tile & 3] */
+    uint32_t rp, rs;
+    memcpy(&rp, rank_plant, 4);
+    memcpy(&rs, rank_poem,  4);
+    const __m128i tile_plant = _mm_setr_epi8(0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3);
+    const __m128i tile_poem  = _mm_setr_epi8(0,1,2,3, 0,1,2,3, 0,1,2,3, 0,1,2,3);
+    __m128i table = _mm_or_si128(
+        _mm_slli_epi16(_mm_shuffle_epi8(_mm_cvtsi32_si128((int)rp), tile_plant), 2),
+        _mm_shuffle_epi8(_mm_cvtsi32_si128((int)rs), tile_poem));
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(table, v));
+}
+
+static inline int tiles_cmp(const uint8_t *a, const uint8_t *b) {
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+                                _mm_loadu_si128((const __m128i *)b));
+    unsigned diff = ~(unsigned)_mm_movemask_epi8(eq) & 0xFFFF;
+    if (diff == 0) return 0;
+    int i = __builtin_ctz(diff);
+    return a[i] - b[i];
+}
+
+#elif defined(NIYA_SIMD_NEON)
+
+/* NEON has no movemask: narrow each byte of a compare result to a nibble */
+static inline uint64_t neon_nibble_mask(uint8x16_t eq) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+static inline int neon_first_index(uint8x16_t v, uint8_t label) {
+    uint64_t m = neon_nibble_mask(vceqq_u8(v, vdupq_n_u8(label)));
+    return m ? __builtin_ctzll(m) >> 2 : 16;
+}
+
+static inline void tiles_permute(const uint8_t *in, const uint8_t *map, uint8_t *out) {
+    vst1q_u8(out, vqtbl1q_u8(vld1q_u8(in), vld1q_u8(map)));
+}
+
+static inline void tiles_swap(const uint8_t *in, uint8_t *out) {
+    uint8x16_t v = vld1q_u8(in);
+    vst1q_u8(out, vorrq_u8(vshlq_n_u8(vandq_u8(v, vdupq_n_u8(3)), 2), vshrq_n_u8(v, 2)));
+}
+
+static inline void tiles_normalize(const uint8_t *in, uint8_t *out) {
+    uint8x16_t v      = vld1q_u8(in);
+    uint8x16_t plants = vshrq_n_u8(v, 2);
+    uint8x16_t poems  = vandq_u8(v, vdupq_n_u8(3));
+    int first_plant[4], first_poem[4];
+    for (int a = 0; a < 4; a++) {
+        first_plant[a] = neon_first_index(plants, (uint8_t)a);
+        first_poem[a]  = neon_first_index(poems,  (uint8_t)a);
+    }
+    uint8_t rank_plant[16] = {0}, rank_poem[16] = {0};
+    first_appearance_ranks(first_plant, rank_plant);
+    first_appearance_ranks(first_poem,  rank_poem);
+
+    /* table[tile] = rank_plant[tile >> 2] << 2 | rank_poem[tile & 3] */
+    static const uint8_t TILE_PLANT[16] = {0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3};
+    static const uint8_t TILE_POEM[16]  = {0,1,2,3, 0,1,2,3, 0,1,2,3, 0,1,2,3};
+    uint8x16_t table = vorrq_u8(
+        vshlq_n_u8(vqtbl1q_u8(vld1q_u8(rank_plant), vld1q_u8(TILE_PLANT)), 2),
+        vqtbl1q_u8(vld1q_u8(rank_poem), vld1q_u8(TILE_POEM)));
+    vst1q_u8(out, vqtbl1q_u8(table, v));
+}
+
+static inline int tiles_cmp(const uint8_t *a, const uint8_t *b) {
+    uint64_t diff = ~neon_nibble_mask(vceqq_u8(vld1q_u8(a), vld1q_u8(b)));
+    if (diff == 0) return 0;
+    int i = __builtin_ctzll(diff) >> 2;
+    return a[i] - b[i];
+}
+
+#else  /* scalar fallback */
+
+static inline void tiles_permute(const uint8_t *in, const uint8_t *map, uint8_t *out) {
+    uint8_t tmp[16];
+    for (int i = 0; i < 16; i++) tmp[i] = in[map[i]];
+    memcpy(out, tmp, 16);
+}
+
+static inline void tiles_swap(const uint8_t *in, uint8_t *out) {
+    for (int i = 0; i < 16; i++)
+        out[i] = (uint8_t)(((in[i] & 3) << 2) | (in[i] >> 2));
+}
+
+static inline void tiles_normalize(const uint8_t *in, uint8_t *out) {
+    int first_plant[4] = {16, 16, 16, 16}, first_poem[4] = {16, 16, 16, 16};
+    for (int i = 15; i >= 0; i--) {
+        first_plant[in[i] >> 2] = i;
+        first_poem[in[i] & 3]   = i;
+    }
+    uint8_t rank_plant[4], rank_poem[4];
+    first_appearance_ranks(first_plant, rank_plant);
+    first_appearance_ranks(first_poem,  rank_poem);
+    for (int i = 0; i < 16; i++)
+        out[i] = (uint8_t)((rank_plant[in[i] >> 2] << 2) | rank_poem[in[i] & 3]);
+}
+
+static inline int tiles_cmp(const uint8_t *a, const uint8_t *b) {
+    for (int i = 0; i < 16; i++)
+        if (a[i] != b[i]) return a[i] - b[i];
+    return 0;
+}
+
+/* Relabel cell by cell and give up at the first cell that exceeds best */
+static inline int tiles_candidate(const uint8_t *in, const uint8_t *map, uint8_t *best) {
+    int8_t plant_label[4] = {-1, -1, -1, -1}, poem_label[4] = {-1, -1, -1, -1};
+    int8_t next_plant = 0, next_poem = 0;
+    uint8_t cand[16];
+    int order = 0;  /* <0 once the candidate is smaller */
+    for (int i = 0; i < 16; i++) {
+        int a = in[map[i]] >> 2, b = in[map[i]] & 3;
+        if (plant_label[a] < 0) plant_label[a] = next_plant++;
+        if (poem_label[b]  < 0) poem_label[b]  = next_poem++;
+        cand[i] = (uint8_t)((plant_label[a] << 2) | poem_label[b]);
+        if (order == 0 && cand[i] != best[i]) {
+            if (cand[i] > best[i]) return 0;
+            order = -1;
+        }
+    }
+    if (order < 0) memcpy(best, cand, 16);
+    return order < 0;
+}
+
+#endif
+
+#if defined(NIYA_SIMD_SSSE3) || defined(NIYA_SIMD_NEON)
+static inline int tiles_candidate(const uint8_t *in, const uint8_t *map, uint8_t *best) {
+    uint8_t cand[16];
+    tiles_permute(in, map, cand);
+    tiles_normalize(cand, cand);
+    if (tiles_cmp(cand, best) >= 0) return 0;
+    memcpy(best, cand, 16);
+    return 1;
+}
+#endif
+
+
+/* ---- Board self-symmetry ---- */
+/*
+ * A board's automorphisms are the spatial symmetries t for which some
+ * relabeling of plants and poems (possibly swapping the two) maps the board
+ * onto itself. Relabeling preserves compatibility and a spatial symmetry
+ * preserves the win patterns and the edge, so under an automorphism every
+ * position is equivalent to its image: same value, same move tree.
+ *
+ * inv[k][c] is where cell c lands under the k-th automorphism; rep[c] is the
+ * lowest cell in c's orbit. Entry 0 is always the identity.
+ */
+typedef struct {
+    int    n;
+    int8_t inv[8][16];
+    int8_t rep[16];
+} BoardSymmetry;
+
+static void find_board_symmetry(const int8_t *plants, const int8_t *poems,
+                                BoardSymmetry *sym) {
+    /* t is an automorphism iff t(board), possibly swapped, has the same
+     * relabeling normal form as the board itself. */
+    uint8_t tiles[16], swapped[16], norm[16], cand[16];
+    tiles_pack(plants, poems, tiles);
+    tiles_swap(tiles, swapped);
+    tiles_normalize(tiles, norm);
+
+    sym->n = 0;
+    for (int t = 0; t < 8; t++) {
+        int fixed = 0;
+        for (int swap = 0; swap < 2 && !fixed; swap++) {
+            tiles_permute(swap ? swapped : tiles, TRANSFORM_MAPS[t], cand);
+            tiles_normalize(cand, cand);
+            fixed = tiles_cmp(cand, norm) == 0;
+        }
+        if (!fixed) continue;
+        for (int i = 0; i < 16; i++)
+            sym->inv[sym->n][TRANSFORM_MAPS[t][i]] = (int8_t)i;
+        sym->n++;
+    }
+    for (int c = 0; c < 16; c++) {
+        int lowest = c;
+        for (int k = 1; k < sym->n; k++)
+            if (sym->inv[k][c] < lowest) lowest = sym->inv[k][c];
+        sym->rep[c] = (int8_t)lowest;
+    }
+}
+
+static inline uint16_t sym_map_mask(const int8_t *inv, uint16_t mask) {
+    uint16_t out = 0;
+    for (; mask; mask &= mask - 1)
+        out |= (uint16_t)(1 << inv[__builtin_ctz(mask)]);
+    return out;
+}
+
+/*
+ * Replace a position by its smallest image under the board's automorphisms,
+ * so equivalent root positions share one set of TT entries and each orbit
+ * is searched once.
+ */
+static void sym_reduce(const BoardSymmetry *sym, uint16_t *p1_mask,
+                       uint16_t *p2_mask, int *last_move) {
+    uint64_t best = (uint64_t)*p1_mask | ((uint64_t)*p2_mask << 16) |
+                    ((uint64_t)*last_move << 32);
+    for (int k = 1; k < sym->n; k++) {
+        uint16_t p1 = sym_map_mask(sym->inv[k], *p1_mask);
+        uint16_t p2 = sym_map_mask(sym->inv[k], *p2_mask);
+        uint64_t key = (uint64_t)p1 | ((uint64_t)p2 << 16) |
+                       ((uint64_t)sym->inv[k][*last_move] << 32);
+        if (key < best) best = key;
+    }
+    *p1_mask   = (uint16_t)best;
+    *p2_mask   = (uint16_t)(best >> 16);
+    *last_move = (int)(best >> 32);
+}
+
+
+/* ---- Zero-window root driver ---- */
+/*
+ * Scores are ternary, so every question the root needs answered is a
+ * zero-window test "is the value >= target?" against P1_WINS or DRAW_SCORE.
+ * Positions are symmetry-reduced first, so the test for an equivalent
+ * position is answered from the TT. Each test goes to alpha-beta or, when
+ * the table carries a df-pn table, to proof-number search.
+ */
+static inline int value_at_least(const uint16_t *compat, const BoardSymmetry *sym,
+                                 uint16_t p1_mask, uint16_t p2_mask,
+                                 int last_move, int is_p1_turn, int target,
+                                 int depth, TTable *tt) {
+    if (sym->n > 1) sym_reduce(sym, &p1_mask, &p2_mask, &last_move);
+    if (tt->dfpn)
+        return dfpn_at_least(compat, tt->dfpn, p1_mask, p2_mask, last_move, is_p1_turn,
+                             target, depth);
+    return minimax(compat, p1_mask, p2_mask, last_move, is_p1_turn,
+                   target - 1, target, depth, tt) >= target;
+}
+
+/* Exact value: "can P1 force a win?", then "can P1 avoid losing?" */
+static int exact_value(const uint16_t *compat, const BoardSymmetry *sym,
+                       uint16_t p1_mask, uint16_t p2_mask, int last_move, int is_p1_turn, int depth, TTable *tt) {
+    if (value_at_least(compat, sym, p1_mask, p2_mask, last_move, is_p1_turn, P1_WINS, depth, tt))
+        return P1_WINS;
+    if (value_at_least(compat, sym, p1_mask, p2_mask, last_move, is_p1_turn, DRAW_SCORE, depth, tt))
+        return DRAW_SCORE;
+    return P1_LOSES;
+}
+
+/*
+ * Lowest-index move in `moves` whose child keeps the position's known
+ * value. This is the canonical tie-break between optimal moves. The mover
+ * can never do better than `value`, so each candidate needs a single test,
+ * and when `value` is the mover's worst result every move qualifies.
+ */
+static int first_optimal_move(const uint16_t *compat, const BoardSymmetry *sym,
+                              uint16_t p1_mask, uint16_t p2_mask, uint16_t moves, int is_p1_turn, int value,
+                              int next_depth, TTable *tt) {
+    if (value == (is_p1_turn ? P1_LOSES : P1_WINS))
+        return __builtin_ctz(moves);
+
+    for (uint16_t rest = moves; rest; rest &= rest - 1) {
+        int move = __builtin_ctz(rest);
+        uint16_t bit = (uint16_t)(1 << move);
+        int keeps = is_p1_turn
+            ? value_at_least(compat, sym, p1_mask | bit, p2_mask, move, 0, value, next_depth, tt)
+            : !value_at_least(compat, sym, p1_mask, p2_mask | bit, move, 1, value + 1, next_depth, tt);
+        if (keeps) return move;
+    }
+    return -1;  /* unreachable when value is exact */
+}
+
+/*
+ * Play out the canonical principal variation from a position of known
+ * value: at every ply the mover takes first_optimal_move. The resulting
+ * game (how it ends and after how many moves) depends only on the board,
+ * not on move ordering or TT contents, so it is what SolveResult reports.
+ */
+static void pv_walk(const uint16_t *compat, const BoardSymmetry *sym,
+                    uint16_t p1_mask, uint16_t p2_mask, int last_move, int is_p1_turn, int value, int depth, TTable *tt,
+                    int8_t *outcome, int8_t *game_depth) {
+    for (;;) {
+        int win = check_win(is_p1_turn ? p2_mask : p1_mask);
+        if (win >= 0) {
+            *outcome = (int8_t)win;
+            break;
+        }
+        if (depth == 16) {
+            *outcome = OUT_DRAW;
+            break;
+        }
+        uint16_t moves = compat[last_move] & (uint16_t)~(p1_mask | p2_mask);
+        if (moves == 0) {
+            *outcome = OUT_BLOCKADE;
+            break;
+        }
+
+        int move = first_optimal_move(compat, sym, p1_mask, p2_mask, moves,
+                                      is_p1_turn, value, depth + 1, tt);
+        if (is_p1_turn) p1_mask |= (uint16_t)(1 << move);
+        else            p2_mask |= (uint16_t)(1 << move);
+        last_move  = move;
+        is_p1_turn = !is_p1_turn;
+        depth++;
+    }
+    *game_depth = (int8_t)depth;
+}
+
+
+/* ================================================================
+ * Public API - called from Python via ctypes
+ * ================================================================ */
+
+/*
+ * Result struct returned to Python.
+ *   best_move:     P1's best opening move index (0-15)
+ *   score:         1 = P1 wins, -1 = P2 wins, 0 = draw
+ *   outcome:       outcome index (maps to OUTCOME_TABLE in Python)
+ *   game_depth:    total moves until game ends
+ *
+ * For P2 analysis, 12 additional entries for each P1 opening:
+ *   p2_moves[12]:      P2's best response for each P1 opening
+ *   p2_scores[12]:     score for each P1 opening line
+ *   p2_outcomes[12]:   outcome index for each
+ */
+typedef struct {
+    int8_t  best_move;
+    int8_t  score;
+    int8_t  outcome;
+    int8_t  game_depth;
+    /* P2 analysis (filled only when skip_p2 == 0) */
+    int8_t  p2_moves[12];
+    int8_t  p2_scores[12];
+    int8_t  p2_outcomes[12];
+} SolveResult;
+
+
+/*
+ * P1's best opening. Ask "can P1 force a win?" of each opening in turn,
+ * then "can P1 avoid losing?"; the first opening that passes is the best
+ * move. If none does, every opening loses. An opening symmetric to a lower
+ * one has already failed the same test.
+ */
+static int best_opening(const uint16_t *compat, const BoardSymmetry *sym, TTable *tt,
+                        int *best_score) {
+    static const int TARGETS[2] = { P1_WINS, DRAW_SCORE };
+    for (int t = 0; t < 2; t++) {
+        for (int oi = 0; oi < NUM_OPENINGS; oi++) {
+            int move = OPENING_INDICES[oi];
+            if (sym->rep[move] != move) continue;
+            if (value_at_least(compat, sym, (uint16_t)(1 << move), 0, move, 0,
+                               TARGETS[t], 1, tt)) {
+                *best_score = TARGETS[t];
+                return move;
+            }
+        }
+    }
+    *best_score = P1_LOSES;
+    return OPENING_INDICES[0];
+}
+
+/*
+ * P2 analysis of one opening of known value: P2's best reply is the first
+ * one (in cell order) that holds the opening to its value, and the line
+ * both sides then follow.
+ */
+static void analyze_opening(const uint16_t *compat, const BoardSymmetry *sym, int oi,
+                            int value, TTable *tt, SolveResult *out) {
+    int p1_move = OPENING_INDICES[oi];
+    uint16_t p1_mask = (uint16_t)(1 << p1_move);
+    int p2_move = first_optimal_move(compat, sym, p1_mask, 0,
+                                     compat[p1_move] & (uint16_t)~p1_mask,
+                                     0, value, 2, tt);
+
+    out->p2_moves[oi]  = (int8_t)p2_move;
+    out->p2_scores[oi] = (int8_t)value;
+    int8_t game_depth;
+    pv_walk(compat, sym, p1_mask, (uint16_t)(1 << p2_move), p2_move, 1, value, 2, tt,
+            &out->p2_outcomes[oi], &game_depth);
+}
+
+
+/*
+ * tt_configure_c - Set the per-thread transposition table size.
+ *
+ * Args:
+ *   bytes: requested size; rounded down to a power-of-two number of
+ *          64-byte buckets and clamped to [128 KB, 64 GB]
+ *
+ * Returns the size configured. Tables already allocated by other threads
+ * are resized at the start of their next solve; one that cannot be mapped
+ * at this size is halved until it can (see tt_begin).
+ */
+size_t tt_configure_c(size_t bytes) {
+    int bits = TT_MIN_BUCKET_BITS;
+    while (bits < TT_MAX_BUCKET_BITS && (sizeof(TTBucket) << (bits + 1)) <= bytes)
+        bits++;
+    __atomic_store_n(&tt_config_bucket_bits, bits, __ATOMIC_RELAXED);
+    return sizeof(TTBucket) << bits;
+}
+
+
+/*
+ * table_memory_c - Where the calling thread's transposition table lives.
+ *
+ * Allocates the table at the configured size if needed, then fills
+ * out[0] = address, out[1] = its size in bytes (less than configured if
+ * that much could not be mapped) and out[2] = the pages asked
+ * for (0 normal, 1 transparent huge pages, 2 explicit huge pages). Whether
+ * transparent huge pages were actually granted shows in /proc/self/smaps.
+ */
+void table_memory_c(uint64_t *out) {
+    TTable *tt = tt_begin_board();
+    out[0] = (uint64_t)(uintptr_t)tt->buckets;
+    out[1] = (uint64_t)sizeof(TTBucket) << tt->bucket_bits;
+    out[2] = (uint64_t)tt->pages;
+}
+
+
+/*
+ * position_cache_configure_c - Enable the shared position cache.
+ *
+ * Args:
+ *   depth: cache positions with this many tiles down, in [8, 15]; any
+ *          other value disables the cache
+ *   bytes: table size; rounded down to a power-of-two number of 64-byte
+ *          buckets and clamped to [128 KB, 64 GB]
+ *
+ * Returns the size actually used (0 when disabled). The table starts
+ * empty. Must not be called while boards are being solved.
+ */
+size_t position_cache_configure_c(int depth, size_t bytes) {
+    if (position_cache.buckets)
+        table_free(position_cache.buckets, sizeof(PCBucket) << position_cache.bucket_bits);
+    position_cache.buckets = NULL;
+    position_cache.depth = 0;
+    if (depth < PC_MIN_DEPTH || depth > 15) return 0;
+
+    int bits = PC_MIN_BUCKET_BITS;
+    while (bits < PC_MAX_BUCKET_BITS && (sizeof(PCBucket) << (bits + 1)) <= bytes)
+        bits++;
+    size_t size = sizeof(PCBucket) << bits;
+    int pages;
+    position_cache.buckets = (PCBucket *)table_alloc(size, &pages);
+    if (!position_cache.buckets) return 0;
+    memset(position_cache.buckets, 0, size);
+    position_cache.bucket_bits = bits;
+    position_cache.depth = depth;
+    return size;
+}
+
+
+/* One board, with alpha-beta or df-pn answering the root tests */
+static void solve_board(const int8_t *plants, const int8_t *poems, int skip_p2, int use_dfpn,
+                        SolveResult *out) {
+    TTable *tt = tt_begin_board();
+    tt->dfpn = use_dfpn ? dfpn_begin_board() : NULL;
+#ifdef NIYA_STATS
+    uint64_t t0 = stat_now_ns();
+#endif
+#ifdef NIYA_TRACE
+    memset(&thread_trace, 0, sizeof(thread_trace));
+    uint64_t trace_t0 = stat_now_ns();
+#endif
+
+    uint16_t compat[16];
+    build_compat(plants, poems, compat);
+    BoardSymmetry sym;
+    find_board_symmetry(plants, poems, &sym);
+
+    /* Phase 1: Find P1's best opening */
+    int best_score;
+    int best_move = best_opening(compat, &sym, tt, &best_score);
+
+    out->best_move = (int8_t)best_move;
+    out->score     = (int8_t)best_score;
+    pv_walk(compat, &sym, (uint16_t)(1 << best_move), 0, best_move, 0, best_score, 1, tt,
+            &out->outcome, &out->game_depth);
+#ifdef NIYA_STATS
+    uint64_t t1 = stat_now_ns();
+    thread_stats.boards++;
+    thread_stats.phase1_ns += t1 - t0;
+#endif
+#ifdef NIYA_TRACE
+    uint64_t trace_phase1_nodes = thread_trace.nodes;
+#endif
+
+    /* Phase 2: P2 analysis */
+    if (skip_p2) {
+        memset(out->p2_moves,    -1, 12);
+        memset(out->p2_scores,    0, 12);
+        memset(out->p2_outcomes,  0, 12);
+        STAT(stat_flush_thread());
+        TRACE(thread_trace.ns = stat_now_ns() - trace_t0);
+        return;
+    }
+
+    for (int oi = 0; oi < NUM_OPENINGS; oi++) {
+        int p1_move = OPENING_INDICES[oi];
+
+        /* Symmetric openings share a value. Their best replies and lines
+         * still differ by the tie-break, but every test along them is a
+         * symmetry-reduced TT hit. */
+        int value;
+        if (p1_move == best_move) {
+            value = best_score;
+        } else if (sym.rep[p1_move] != p1_move) {
+            int ri = 0;
+            while (OPENING_INDICES[ri] != sym.rep[p1_move]) ri++;
+            value = out->p2_scores[ri];
+        } else {
+            value = exact_value(compat, &sym, (uint16_t)(1 << p1_move), 0, p1_move, 0, 1, tt);
+        }
+        analyze_opening(compat, &sym, oi, value, tt, out);
+    }
+#ifdef NIYA_STATS
+    thread_stats.phase2_ns += stat_now_ns() - t1;
+    stat_flush_thread();
+#endif
+    TRACE(thread_trace.phase2_nodes = thread_trace.nodes - trace_phase1_nodes;
+          thread_trace.ns = stat_now_ns() - trace_t0);
+}
+
+/*
+ * solve_board_c - Solve a single Niya board.
+ *
+ * Args:
+ *   plants[16], poems[16]: board tile attributes
+ *   skip_p2: if nonzero, skip P2 analysis
+ *   out: pointer to SolveResult to fill
+ *
+ * Ties between equally good moves go to the lowest cell index (openings in
+ * OPENING_INDICES order), and outcome/game_depth describe the game where
+ * both sides follow that rule (see pv_walk).
+ */
+void solve_board_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int skip_p2,
+    SolveResult *out
+) {
+    solve_board(plants, poems, skip_p2, 0, out);
+}
+
+
+/*
+ * solve_board_dfpn_c - solve_board_c with every root test answered by
+ * proof-number search instead of alpha-beta (see dfpn_mid). Same
+ * arguments, and the same SolveResult for every board.
+ */
+void solve_board_dfpn_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int skip_p2,
+    SolveResult *out
+) {
+    solve_board(plants, poems, skip_p2, 1, out);
+}
+
+
+/*
+ * solver_trace_c - Copy the trace of the last board solved on the calling
+ * thread (by solve_board_c or solve_board_dfpn_c) into *out. Returns 1 if
+ * the library was built with -DNIYA_TRACE, else 0 (and *out is all zeros).
+ */
+int solver_trace_c(BoardTrace *out) {
+#ifdef NIYA_TRACE
+    *out = thread_trace;
+    return 1;
+#else
+    memset(out, 0, sizeof(*out));
+    return 0;
+#endif
+}
+
+
+/*
+ * solver_stats_c - Copy the search counters summed over every board solved
+ * since the last reset (all threads) into *out; a nonzero `reset` zeroes
+ * them. Returns 1 if the library was built with -DNIYA_STATS, else 0 (and
+ * *out is all zeros).
+ */
+int solver_stats_c(SolverStats *out, int reset) {
+#ifdef NIYA_STATS
+    uint64_t *src = (uint64_t *)&solver_stats;
+    uint64_t *dst = (uint64_t *)out;
+    for (size_t i = 0; i < sizeof(SolverStats) / sizeof(uint64_t); i++)
+        dst[i] = reset ? __atomic_exchange_n(&src[i], 0, __ATOMIC_RELAXED)
+                       : __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    return 1;
+#else
+    memset(out, 0, sizeof(*out));
+    (void)reset;
+    return 0;
+#endif
+}
+
+
+/* ================================================================
+ * Batch solving
+ *
+ * A persistent pool of worker threads solves many boards per call. Each
+ * worker keeps its own transposition table (see tt_begin_board), so the
+ * tables are allocated once per thread rather than once per call. The
+ * calling thread works alongside the pool.
+ * ================================================================ */
+
+#define BATCH_SKIP_P2     1   /* flags: same as solve_board_c's skip_p2 */
+#define BATCH_DFPN        2   /* ... solve with solve_board_dfpn_c */
+#define BATCH_MAX_THREADS 256
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  work_ready;
+    pthread_cond_t  work_done;
+    int             started;     /* worker threads created so far */
+    int             wanted;      /* workers taking part in the current job */
+    int             busy;        /* workers still on the current job */
+    uint64_t        job;         /* bumped once per job */
+
+    void          (*run)(void *arg);  /* current job, run by every thread taking part */
+    void           *arg;
+    uint64_t        pin_version; /* bumped by pool_pin_c */
+} WorkerPool;
+
+static WorkerPool worker_pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    0, 0, 0, 0, NULL, NULL, 0
+};
+
+/* Serializes concurrent callers; the pool runs one job at a time */
+static pthread_mutex_t pool_call_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * CPU pinning (Linux): pool thread k, counting the caller as 0, runs on
+ * pin_sets[k % pin_count]. Each thread moves itself at the start of its
+ * next job after the sets change. pin_count 0 restores the affinity the
+ * process had before the first pool_pin_c.
+ */
+#ifdef __linux__
+static cpu_set_t pin_sets[BATCH_MAX_THREADS];
+static cpu_set_t pin_original;
+static int       pin_count;
+static int       pin_saved;
+
+static void pool_apply_pin(int k, uint64_t version, uint64_t *applied) {
+    if (*applied == version) return;
+    *applied = version;
+    if (!pin_count && !pin_saved) return;
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                           pin_count ? &pin_sets[k % pin_count] : &pin_original);
+}
+#else
+static void pool_apply_pin(int k, uint64_t version, uint64_t *applied) {
+    (void)k;
+    *applied = version;
+}
+#endif
+
+static void *pool_worker(void *arg) {
+    WorkerPool *pool = &worker_pool;
+    int id = (int)(intptr_t)arg;
+    uint64_t seen = 0, pinned = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->job == seen || id >= pool->wanted)
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        seen = pool->job;
+        pool_apply_pin(id + 1, pool->pin_version, &pinned);
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->run(pool->arg);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->work_done);
+    }
+    return NULL;
+}
+
+/* Thread count for a call: <= 0 means one per CPU, and no more than useful */
+static int pool_threads(int nthreads, size_t useful) {
+    if (nthreads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (nthreads > BATCH_MAX_THREADS) nthreads = BATCH_MAX_THREADS;
+    if ((size_t)nthreads > useful) nthreads = useful > 0 ? (int)useful : 1;
+    return nthreads;
+}
+
+/*
+ * Run run(arg) on the calling thread and nthreads - 1 pool workers, and
+ * return once all of them are done. The caller holds pool_call_lock.
+ * Returns the number of threads used.
+ */
+static int pool_run(void (*run)(void *), void *arg, int nthreads) {
+    WorkerPool *pool = &worker_pool;
+
+    /* Grow the pool on demand; if the system refuses more threads, run
+     * the job with the ones we have. */
+    pthread_mutex_lock(&pool->lock);
+    while (pool->started < nthreads - 1) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, pool_worker, (void *)(intptr_t)pool->started) != 0)
+            break;
+        pthread_detach(th);
+        pool->started++;
+    }
+    int workers = nthreads - 1 < pool->started ? nthreads - 1 : pool->started;
+
+    pool->run    = run;
+    pool->arg    = arg;
+    pool->wanted = workers;
+    pool->busy   = workers;
+    pool->job++;
+    static __thread uint64_t caller_pinned = 0;
+    pool_apply_pin(0, pool->pin_version, &caller_pinned);
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run(arg);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    pool->wanted = 0;
+    pthread_mutex_unlock(&pool->lock);
+    return workers + 1;
+}
+
+/*
+ * pool_pin_c - Pin the batch and parallel solvers' threads to CPU sets.
+ *
+ * Args:
+ *   masks: n CPU sets of 128 bytes each, CPU c being bit c % 8 of byte
+ *          c / 8 (the glibc cpu_set_t layout); thread k of a call (the
+ *          caller is 0) runs on set k % n, e.g. one core or one NUMA node
+ *          per set
+ *   n:     number of sets, at most 256; 0 unpins
+ *
+ * Returns n, or -1 where pinning is not supported (not Linux) or n is out
+ * of range. Takes effect at each thread's next job.
+ */
+int pool_pin_c(const uint8_t *masks, int n) {
+#ifdef __linux__
+    if (n < 0 || n > BATCH_MAX_THREADS) return -1;
+    pthread_mutex_lock(&pool_call_lock);
+    pthread_mutex_lock(&worker_pool.lock);
+    if (!pin_saved)
+        pin_saved = sched_getaffinity(0, sizeof(cpu_set_t), &pin_original) == 0;
+    for (int k = 0; k < n; k++) {
+        CPU_ZERO(&pin_sets[k]);
+        for (int c = 0; c < CPU_SETSIZE && c < 128 * 8; c++)
+            if (masks[128 * k + c / 8] >> (c % 8) & 1)
+                CPU_SET(c, &pin_sets[k]);
+    }
+    pin_count = n;
+    worker_pool.pin_version++;
+    pthread_mutex_unlock(&worker_pool.lock);
+    pthread_mutex_unlock(&pool_call_lock);
+    return n;
+#else
+    (void)masks;
+    return n == 0 ? 0 : -1;
+#endif
+}
+
+typedef struct {
+    const int8_t   *boards;      /* n * 32 bytes: plants[16], poems[16] */
+    size_t          n;
+    int             skip_p2;
+    int             dfpn;
+    SolveResult    *out;
+    BoardTrace     *trace;       /* per-board traces, or NULL */
+    size_t          next;        /* next unclaimed board (atomic) */
+} BatchJob;
+
+static void batch_run(void *arg) {
+    BatchJob *job = (BatchJob *)arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->n) break;
+        const int8_t *board = job->boards + 32 * i;
+        solve_board(board, board + 16, job->skip_p2, job->dfpn, &job->out[i]);
+        TRACE(if (job->trace) job->trace[i] = thread_trace);
+    }
+}
+
+
+/*
+ * solve_boards_trace_c - solve_boards_batch_c that also fills trace[i]
+ * with board i's search trace (see thread_trace), or NULL for none. The
+ * traces are all zeros unless the library was built with -DNIYA_TRACE
+ * (solver_trace_c tells which).
+ */
+int solve_boards_trace_c(
+    const int8_t *boards,
+    size_t n,
+    int flags,
+    SolveResult *out,
+    BoardTrace *trace,
+    int nthreads
+) {
+#ifndef NIYA_TRACE
+    if (trace) memset(trace, 0, n * sizeof(*trace));
+#endif
+    BatchJob job = { boards, n, (flags & BATCH_SKIP_P2) != 0, (flags & BATCH_DFPN) != 0, out,
+                     trace, 0 };
+    pthread_mutex_lock(&pool_call_lock);
+    int used = pool_run(batch_run, &job, pool_threads(nthreads, n));
+    pthread_mutex_unlock(&pool_call_lock);
+    return used;
+}
+
+
+/*
+ * solve_boards_batch_c - Solve many boards with a thread pool.
+ *
+ * Args:
+ *   boards:   n boards, 32 bytes each: plants[16] then poems[16]
+ *   n:        number of boards
+ *   flags:    BATCH_SKIP_P2 to skip P2 analysis, BATCH_DFPN for df-pn
+ *   out:      n SolveResults, filled in board order
+ *   nthreads: total threads including the caller; <= 0 means one per CPU
+ *
+ * Returns the number of threads actually used. Results are identical to
+ * calling solve_board_c on each board.
+ */
+int solve_boards_batch_c(
+    const int8_t *boards,
+    size_t n,
+    int flags,
+    SolveResult *out,
+    int nthreads
+) {
+    return solve_boards_trace_c(boards, n, flags, out, NULL, nthreads);
+}
+
+
+/* ================================================================
+ * Parallel single-board solve
+ *
+ * solve_board_parallel_c spreads one board over the worker pool for
+ * interactive latency; batch mode keeps one board per thread. The root
+ * questions are independent zero-window tests, handed out in the order
+ * the serial solver asks them (youngest brothers wait only for a claim,
+ * not for their elders' results):
+ *   phase 1  (target, opening) tests. Once a test passes, the tests
+ *            after it are skipped, so each thread wastes at most the one
+ *            test it is running.
+ *   phase 2  P1's principal variation and the P2 analysis of each
+ *            opening, one task each.
+ * Every thread probes and fills one shared table (shared_tt, see the TT
+ * notes above). Results are identical to solve_board_c.
+ * ================================================================ */
+
+typedef struct {
+    uint16_t        compat[16];
+    BoardSymmetry   sym;
+    TTable         *tt;
+    SolveResult    *out;
+    int             next;        /* next unclaimed task (atomic) */
+    int             ntasks;
+
+    /* Phase 1: test i asks whether opening test_move[i] reaches test_target[i] */
+    int8_t          test_move[2 * NUM_OPENINGS];
+    int8_t          test_target[2 * NUM_OPENINGS];
+    int             first_pass;  /* lowest passing test (atomic) */
+
+    /* Phase 2 */
+    int             best_move;
+    int             best_score;
+} ParallelSolve;
+
+static TTable shared_tt = { NULL, 0, 0, NULL, 0 };
+
+static void parallel_phase1(void *arg) {
+    ParallelSolve *ps = (ParallelSolve *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&ps->next, 1, __ATOMIC_RELAXED);
+        if (i >= ps->ntasks || i > __atomic_load_n(&ps->first_pass, __ATOMIC_RELAXED))
+            break;
+        int move = ps->test_move[i];
+        if (!value_at_least(ps->compat, &ps->sym, (uint16_t)(1 << move), 0, move, 0,
+                            ps->test_target[i], 1, ps->tt))
+            continue;
+        int cur = __atomic_load_n(&ps->first_pass, __ATOMIC_RELAXED);
+        while (i < cur && !__atomic_compare_exchange_n(&ps->first_pass, &cur, i, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+    }
+    STAT(stat_flush_thread());
+}
+
+/* Task 0 is P1's line, task 1 + oi the P2 analysis of opening oi */
+static void parallel_phase2(void *arg) {
+    ParallelSolve *ps = (ParallelSolve *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&ps->next, 1, __ATOMIC_RELAXED);
+        if (i >= ps->ntasks) break;
+        if (i == 0) {
+            pv_walk(ps->compat, &ps->sym, (uint16_t)(1 << ps->best_move), 0, ps->best_move, 0,
+                    ps->best_score, 1, ps->tt, &ps->out->outcome, &ps->out->game_depth);
+            continue;
+        }
+        int oi = i - 1, p1_move = OPENING_INDICES[oi];
+        int value = p1_move == ps->best_move ? ps->best_score
+                  : exact_value(ps->compat, &ps->sym, (uint16_t)(1 << p1_move), 0,
+                                p1_move, 0, 1, ps->tt);
+        analyze_opening(ps->compat, &ps->sym, oi, value, ps->tt, ps->out);
+    }
+    STAT(stat_flush_thread());
+}
+
+
+/*
+ * solve_board_parallel_c - Solve a single board on several threads.
+ *
+ * Args:
+ *   plants[16], poems[16], skip_p2, out: as for solve_board_c
+ *   nthreads: total threads including the caller; <= 0 means one per CPU
+ *
+ * Returns the number of threads actually used. Results are identical to
+ * solve_board_c. Concurrent calls (and batch calls) run one at a time.
+ */
+int solve_board_parallel_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int skip_p2,
+    SolveResult *out,
+    int nthreads
+) {
+    ParallelSolve ps;
+    build_compat(plants, poems, ps.compat);
+    find_board_symmetry(plants, poems, &ps.sym);
+    ps.out = out;
+
+    pthread_mutex_lock(&pool_call_lock);
+    tt_begin(&shared_tt);
+    ps.tt = &shared_tt;
+#ifdef NIYA_STATS
+    uint64_t t0 = stat_now_ns();
+#endif
+
+    /* Phase 1: the same tests as solve_board_c, in the same order */
+    static const int TARGETS[2] = { P1_WINS, DRAW_SCORE };
+    ps.ntasks = 0;
+    for (int t = 0; t < 2; t++) {
+        for (int oi = 0; oi < NUM_OPENINGS; oi++) {
+            int move = OPENING_INDICES[oi];
+            if (ps.sym.rep[move] != move) continue;
+            ps.test_move[ps.ntasks]   = (int8_t)move;
+            ps.test_target[ps.ntasks] = (int8_t)TARGETS[t];
+            ps.ntasks++;
+        }
+    }
+    ps.next = 0;
+    ps.first_pass = ps.ntasks;
+    int used = pool_run(parallel_phase1, &ps, pool_threads(nthreads, (size_t)ps.ntasks));
+
+    ps.best_move  = OPENING_INDICES[0];
+    ps.best_score = P1_LOSES;
+    if (ps.first_pass < ps.ntasks) {
+        ps.best_move  = ps.test_move[ps.first_pass];
+        ps.best_score = ps.test_target[ps.first_pass];
+    }
+    out->best_move = (int8_t)ps.best_move;
+    out->score     = (int8_t)ps.best_score;
+#ifdef NIYA_STATS
+    uint64_t t1 = stat_now_ns();
+    thread_stats.boards++;
+    thread_stats.phase1_ns += t1 - t0;
+#endif
+
+    /* Phase 2: P1's line alongside the P2 analysis */
+    if (skip_p2) {
+        memset(out->p2_moves,    -1, 12);
+        memset(out->p2_scores,    0, 12);
+        memset(out->p2_outcomes,  0, 12);
+    }
+    ps.next = 0;
+    ps.ntasks = skip_p2 ? 1 : 1 + NUM_OPENINGS;
+    int used2 = pool_run(parallel_phase2, &ps, pool_threads(nthreads, (size_t)ps.ntasks));
+    if (used2 > used) used = used2;
+#ifdef NIYA_STATS
+    thread_stats.phase2_ns += stat_now_ns() - t1;
+    stat_flush_thread();
+#endif
+
+    pthread_mutex_unlock(&pool_call_lock);
+    return used;
+}
+
+
+/* ================================================================
+ * Position play
+ *
+ * best_move_c answers "what should the side to move play here?" for any
+ * position of a game in progress, which is what an interactive opponent
+ * needs (the web AI runs this file compiled to WebAssembly). Perfect
+ * play uses the same root driver and tie-break as solve_board_c, so on
+ * the start position and after each opening its moves are the stored
+ * best_move and p2_best_move. A limited horizon gives a weaker player.
+ * ================================================================ */
+
+/*
+ * Plain alpha-beta that looks `plies` moves ahead and scores the horizon
+ * as a draw. No TT: with bounded lookahead, values depend on the depth
+ * left and would poison entries shared with exact searches.
+ */
+static int horizon_value(const uint16_t *compat, uint16_t p1_mask, uint16_t p2_mask,
+                         int last_move, int is_p1_turn, int alpha, int beta, int plies) {
+    if (check_win(is_p1_turn ? p2_mask : p1_mask) >= 0)
+        return is_p1_turn ? P1_LOSES : P1_WINS;
+    uint16_t taken = p1_mask | p2_mask;
+    if (taken == 0xFFFF || plies == 0) return DRAW_SCORE;
+    uint16_t moves = compat[last_move] & (uint16_t)~taken;
+    if (moves == 0) return is_p1_turn ? P1_LOSES : P1_WINS;
+
+    int best_score = is_p1_turn ? NEG_INF : INF;
+    for (uint16_t rest = moves; rest && alpha < beta; rest &= rest - 1) {
+        int move = __builtin_ctz(rest);
+        uint16_t bit = (uint16_t)(1 << move);
+        if (is_p1_turn) {
+            int s = horizon_value(compat, p1_mask | bit, p2_mask, move, 0, alpha, beta, plies - 1);
+            if (s > best_score) best_score = s;
+            if (s > alpha) alpha = s;
+        } else {
+            int s = horizon_value(compat, p1_mask, p2_mask | bit, move, 1, alpha, beta, plies - 1);
+            if (s < best_score) best_score = s;
+            if (s < beta) beta = s;
+        }
+    }
+    return best_score;
+}
+
+
+/*
+ * best_move_c - Move for the side to move.
+ *
+ * Args:
+ *   plants[16], poems[16]: board tile attributes
+ *   p1_mask, p2_mask: cells taken by each player (P1 moves when the
+ *                     counts are equal)
+ *   last_move: cell of the previous move, or -1 before the first
+ *   max_plies: 0 for perfect play (lowest-index optimal move); otherwise
+ *              look this many plies ahead, scoring the horizon as a draw,
+ *              and take the first move with the best score
+ *
+ * Returns the cell to play, or -1 if the game is already over.
+ */
+int best_move_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int p1_mask,
+    int p2_mask,
+    int last_move,
+    int max_plies
+) {
+    uint16_t p1 = (uint16_t)p1_mask, p2 = (uint16_t)p2_mask;
+    int depth = __builtin_popcount(p1) + __builtin_popcount(p2);
+    int is_p1_turn = __builtin_popcount(p1) == __builtin_popcount(p2);
+    if (check_win(is_p1_turn ? p2 : p1) >= 0 || depth == 16) return -1;
+
+    uint16_t compat[16];
+    build_compat(plants, poems, compat);
+    uint16_t moves = 0;
+    if (last_move < 0) {
+        for (int oi = 0; oi < NUM_OPENINGS; oi++)
+            moves |= (uint16_t)(1 << OPENING_INDICES[oi]);
+    } else {
+        moves = compat[last_move] & (uint16_t)~(p1 | p2);
+    }
+    if (moves == 0) return -1;
+
+    if (max_plies > 0) {
+        int best_move = __builtin_ctz(moves);
+        int alpha = NEG_INF, beta = INF;
+        for (uint16_t rest = moves; rest && alpha < beta; rest &= rest - 1) {
+            int move = __builtin_ctz(rest);
+            uint16_t bit = (uint16_t)(1 << move);
+            if (is_p1_turn) {
+                int s = horizon_value(compat, p1 | bit, p2, move, 0, alpha, beta, max_plies - 1);
+                if (s > alpha) { alpha = s; best_move = move; }
+            } else {
+                int s = horizon_value(compat, p1, p2 | bit, move, 1, alpha, beta, max_plies - 1);
+                if (s < beta) { beta = s; best_move = move; }
+            }
+        }
+        return best_move;
+    }
+
+    TTable *tt = tt_begin_board();
+    BoardSymmetry sym;
+    find_board_symmetry(plants, poems, &sym);
+    if (last_move < 0) {
+        int score;
+        return best_opening(compat, &sym, tt, &score);
+    }
+    int value = exact_value(compat, &sym, p1, p2, last_move, is_p1_turn, depth, tt);
+    return first_optimal_move(compat, &sym, p1, p2, moves, is_p1_turn, value, depth + 1, tt);
+}
+
+
+/* ================================================================
+ * Board canonicalization
+ *
+ * Finds the lexicographically smallest board among all equivalences:
+ *   8 spatial symmetries × 24 plant perms × 24 poem perms × 2 swap
+ *   = 9,216 total transforms
+ *
+ * For a fixed spatial transform and swap, the smallest relabeling numbers
+ * plants and poems in order of first appearance, so canonicalize_board_c
+ * needs only 16 greedy passes. canonicalize_board_bruteforce_c tries all
+ * 9,216 transforms and is kept as the reference it is checked against.
+ * ================================================================ */
+
+/* All 24 permutations of {0,1,2,3} */
+static const int LABEL_PERMS[24][4] = {
+    {0,1,2,3},{0,1,3,2},{0,2,1,3},{0,2,3,1},{0,3,1,2},{0,3,2,1},
+    {1,0,2,3},{1,0,3,2},{1,2,0,3},{1,2,3,0},{1,3,0,2},{1,3,2,0},
+    {2,0,1,3},{2,0,3,1},{2,1,0,3},{2,1,3,0},{2,3,0,1},{2,3,1,0},
+    {3,0,1,2},{3,0,2,1},{3,1,0,2},{3,1,2,0},{3,2,0,1},{3,2,1,0},
+};
+#define NUM_LABEL_PERMS 24
+
+
+/*
+ * Compare two boards lexicographically.
+ * Board = (plants[0], poems[0], plants[1], poems[1], ...)
+ * Returns: <0 if a<b, 0 if a==b, >0 if a>b
+ */
+static inline int board_cmp(const int8_t *ap, const int8_t *as,
+                            const int8_t *bp, const int8_t *bs) {
+    for (int i = 0; i < 16; i++) {
+        if (ap[i] != bp[i]) return ap[i] - bp[i];
+        if (as[i] != bs[i]) return as[i] - bs[i];
+    }
+    return 0;
+}
+
+
+/*
+ * canonicalize_board_bruteforce_c - Reference canonicalizer: tries every
+ * transform. Same contract as canonicalize_board_c.
+ */
+void canonicalize_board_bruteforce_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int8_t *out_plants,
+    int8_t *out_poems
+) {
+    /* Start with input as best */
+    memcpy(out_plants, plants, 16);
+    memcpy(out_poems,  poems,  16);
+
+    int8_t cp[16], cs[16]; /* candidate plants/poems */
+
+    for (int t = 0; t < 8; t++) {
+        /* Apply spatial transform */
+        int8_t sp[16], ss[16];
         for (int i = 0; i < 16; i++) {
             sp[i] = plants[TRANSFORM_MAPS[t][i]];
             ss[i] = poems[TRANSFORM_MAPS[t][i]];
@@ -476,3 +2487,790 @@ void canonicalize_board_c(
         }
     }
 }
+
+
+/*
+ * tiles_canonicalize - canonicalize_board_c on packed tiles. Returns the
+ * spatial transform t that produced the canonical board (its cell i is the
+ * input's TRANSFORM_MAPS[t][i]).
+ */
+static int tiles_canonicalize(const uint8_t *in, uint8_t *best) {
+    uint8_t tiles[2][16];
+    memcpy(tiles[0], in, 16);
+    tiles_swap(tiles[0], tiles[1]);
+
+    int best_t = 0;
+    tiles_normalize(tiles[0], best);
+    for (int t = 0; t < 8; t++) {
+        for (int swap = 0; swap < 2; swap++) {
+            if (tiles_candidate(tiles[swap], TRANSFORM_MAPS[t], best)) best_t = t;
+        }
+    }
+    return best_t;
+}
+
+
+/*
+ * canonicalize_board_c - Find the canonical (lex-smallest) board.
+ *
+ * Args:
+ *   plants[16], poems[16]: input board
+ *   out_plants[16], out_poems[16]: canonical board (output)
+ *
+ * Each of the 16 (spatial transform, swap) candidates is one shuffle plus a
+ * first-appearance relabel; see the board kernels.
+ */
+void canonicalize_board_c(
+    const int8_t *plants,
+    const int8_t *poems,
+    int8_t *out_plants,
+    int8_t *out_poems
+) {
+    uint8_t tiles[16], best[16];
+    tiles_pack(plants, poems, tiles);
+    tiles_canonicalize(tiles, best);
+    tiles_unpack(best, out_plants, out_poems);
+}
+
+
+/* ================================================================
+ * Canonical enumeration
+ *
+ * Orderly generation over the permutation tree: boards are built cell by
+ * cell in increasing lexicographic order, and a prefix is abandoned as soon
+ * as one of the 16 (spatial transform, swap) candidates is already known to
+ * be smaller. Every canonical board is emitted exactly once, in increasing
+ * order, so the last board emitted is a complete resume cursor.
+ *
+ * Two prunings keep the tree small:
+ *   - labels must appear in first-appearance order (a canonical board is
+ *     its own relabeling normal form), which removes the 24 × 24 relabels;
+ *   - a candidate is compared on the leading cells it can already see,
+ *     i.e. while TRANSFORM_MAPS[t][i] points at an assigned cell. Once it
+ *     is larger it can never undercut this prefix and is dropped from the
+ *     subtree.
+ * ================================================================ */
+
+typedef struct {
+    uint8_t   tiles[16];     /* board under construction, packed tiles */
+    uint8_t   swapped[16];   /* the same cells with plant and poem exchanged */
+    uint8_t   bound[16];     /* resume strictly after this board */
+    int       leaf_depth;    /* 16 for boards; less to list viable prefixes */
+    const uint8_t *stop_at;  /* stop, without counting it, at this board */
+    int8_t   *out;           /* boards emitted (plants[16], poems[16]) or NULL */
+    uint64_t *prefixes;      /* prefix keys emitted when leaf_depth < 16 */
+    size_t    max, count;
+} Enumerator;
+
+/* Search state below an assigned prefix */
+typedef struct {
+    int      depth;
+    uint16_t used;           /* tiles already placed */
+    int      plants_seen, poems_seen;
+    uint16_t undecided;      /* candidates not yet known to be larger */
+} EnumNode;
+
+/* Tiles packed 4 bits each, first cell in the top nibble: numeric order of
+ * keys is lexicographic order of boards (and of equal-length prefixes). */
+static inline uint64_t tiles_key(const uint8_t *tiles, int n) {
+    uint64_t key = 0;
+    for (int i = 0; i < n; i++)
+        key |= (uint64_t)tiles[i] << (60 - 4 * i);
+    return key;
+}
+
+/*
+ * Check candidates against the first `assigned` cells. Clears those that
+ * are already larger from *undecided; returns 0 if one is smaller.
+ * Candidate c is spatial transform c >> 1, swapped if c & 1; candidate 0 is
+ * the board itself.
+ */
+static int enum_prefix_ok(const Enumerator *e, int assigned, uint16_t *undecided) {
+    for (uint16_t rest = *undecided; rest; rest &= rest - 1) {
+        int c = __builtin_ctz(rest);
+        const uint8_t *map = TRANSFORM_MAPS[c >> 1];
+        const uint8_t *src = (c & 1) ? e->swapped : e->tiles;
+        int8_t plant_label[4] = {-1, -1, -1, -1}, poem_label[4] = {-1, -1, -1, -1};
+        int8_t next_plant = 0, next_poem = 0;
+
+        for (int i = 0; i < assigned && map[i] < assigned; i++) {
+            int a = src[map[i]] >> 2, b = src[map[i]] & 3;
+            if (plant_label[a] < 0) plant_label[a] = next_plant++;
+            if (poem_label[b]  < 0) poem_label[b]  = next_poem++;
+            int cand = (plant_label[a] << 2) | poem_label[b];
+            if (cand < e->tiles[i]) return 0;
+            if (cand > e->tiles[i]) {
+                *undecided &= (uint16_t)~(1u << c);
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Place `tile` at node->depth. Returns 0 if it is illegal or the prefix
+ * can no longer be canonical; *node is then unspecified. */
+static int enum_place(Enumerator *e, EnumNode *node, int tile) {
+    int plant = tile >> 2, poem = tile & 3;
+    if ((node->used & (1u << tile)) ||
+        plant > node->plants_seen || poem > node->poems_seen)
+        return 0;
+    e->tiles[node->depth]   = (uint8_t)tile;
+    e->swapped[node->depth] = (uint8_t)((poem << 2) | plant);
+    if (!enum_prefix_ok(e, node->depth + 1, &node->undecided)) return 0;
+    node->used |= (uint16_t)(1u << tile);
+    node->plants_seen += plant == node->plants_seen;
+    node->poems_seen  += poem  == node->poems_seen;
+    node->depth++;
+    return 1;
+}
+
+/* Root of the enumeration: every candidate except the identity undecided */
+static inline EnumNode enum_root(void) {
+    EnumNode root = { 0, 0, 0, 0, (uint16_t)0xFFFE };
+    return root;
+}
+
+/* Descend along `prefix`; returns 0 if no canonical board starts with it */
+static int enum_seed(Enumerator *e, const uint8_t *prefix, int n, EnumNode *node) {
+    *node = enum_root();
+    for (int i = 0; i < n; i++)
+        if (!enum_place(e, node, prefix[i])) return 0;
+    return 1;
+}
+
+/* Returns 1 once the enumeration should stop */
+static int enum_rec(Enumerator *e, const EnumNode *node, int bounded) {
+    if (node->depth == e->leaf_depth) {
+        if (bounded) return 0;  /* the cursor board itself */
+        if (e->stop_at && memcmp(e->tiles, e->stop_at, 16) == 0) return 1;
+        if (e->out) {
+            int8_t *dst = e->out + 32 * e->count;
+            tiles_unpack(e->tiles, dst, dst + 16);
+        }
+        if (e->prefixes)
+            e->prefixes[e->count] = tiles_key(e->tiles, e->leaf_depth);
+        return ++e->count == e->max;
+    }
+
+    int first = bounded ? e->bound[node->depth] : 0;
+    for (int tile = first; tile < 16; tile++) {
+        /* Tiles are ordered by plant; past the next new plant nothing fits */
+        if ((tile >> 2) > node->plants_seen) break;
+        EnumNode child = *node;
+        if (!enum_place(e, &child, tile)) continue;
+        if (enum_rec(e, &child, bounded && tile == first))
+            return 1;
+    }
+    return 0;
+}
+
+static void enum_init(Enumerator *e) {
+    memset(e, 0, sizeof(*e));
+    e->leaf_depth = 16;
+    e->max = SIZE_MAX;
+}
+
+
+/*
+ * enumerate_canonical_c - Emit the next canonical boards in lexicographic
+ * order.
+ *
+ * Args:
+ *   cursor: 16 packed tiles, (plant << 2) | poem. On entry, enumeration
+ *           resumes strictly after this board; a cursor starting with 0xFF
+ *           starts from the beginning. On return it holds the last board
+ *           emitted (unchanged if none was).
+ *   out:    room for `max` boards, 32 bytes each: plants[16] then poems[16]
+ *           (the solve_boards_batch_c layout)
+ *   max:    batch size
+ *
+ * Returns the number of boards written; fewer than `max` means the
+ * enumeration is complete.
+ */
+size_t enumerate_canonical_c(uint8_t *cursor, int8_t *out, size_t max) {
+    if (max == 0) return 0;
+
+    Enumerator e;
+    enum_init(&e);
+    e.out = out;
+    e.max = max;
+    int bounded = cursor[0] != 0xFF;
+    if (bounded) memcpy(e.bound, cursor, 16);
+
+    EnumNode root = enum_root();
+    enum_rec(&e, &root, bounded);
+
+    if (e.count > 0) {
+        const int8_t *last = out + 32 * (e.count - 1);
+        for (int i = 0; i < 16; i++)
+            cursor[i] = (uint8_t)((last[i] << 2) | last[16 + i]);
+    }
+    return e.count;
+}
+
+
+/* ================================================================
+ * Dense class ranking
+ *
+ * The rank of a canonical board is its position in enumeration order, so
+ * ranks cover [0, N_classes) with no gaps. A rank table makes that cheap:
+ * for every viable prefix of RANK_PREFIX_DEPTH cells (sorted keys) it stores
+ * the number of canonical boards before the prefix, plus the running count
+ * before each of its RANK_CHILD_SLOTS possible next tiles. What is left is a
+ * walk of one depth-10 subtree (at most 6! boards).
+ *
+ * File layout (native endianness):
+ *   RankTableHeader
+ *   uint64_t keys[n_prefixes]                      tiles_key of each prefix
+ *   uint32_t before[n_prefixes]                    boards before the prefix
+ *   uint16_t child_before[n_prefixes][RANK_CHILD_SLOTS]
+ *                                                  boards before each child,
+ *                                                  relative to the prefix
+ * Child slot j is the j-th smallest tile not in the prefix. A prefix has
+ * at most 7! = 5040 boards below it and N_classes < 2^32, so the narrow
+ * counts cannot overflow.
+ * ================================================================ */
+
+#define RANK_PREFIX_DEPTH 9
+#define RANK_CHILD_SLOTS  (16 - RANK_PREFIX_DEPTH)
+#define RANK_MAGIC        "NIYARNK1"
+
+typedef struct {
+    char     magic[8];
+    uint32_t prefix_depth;
+    uint32_t child_slots;
+    uint64_t n_prefixes;
+    uint64_t n_classes;
+} RankTableHeader;
+
+typedef struct {
+    const RankTableHeader *header;
+    const uint64_t        *keys;
+    const uint32_t        *before;
+    const uint16_t        (*child_before)[RANK_CHILD_SLOTS];
+    size_t                 map_bytes;
+} RankTable;
+
+static RankTable rank_table;
+
+/* j-th smallest tile missing from `used` */
+static inline int nth_free_tile(uint16_t used, int j) {
+    uint16_t free_tiles = (uint16_t)~used;
+    while (j-- > 0) free_tiles &= free_tiles - 1;
+    return __builtin_ctz(free_tiles);
+}
+
+typedef struct {
+    const uint64_t *keys;
+    uint32_t       (*child_count)[RANK_CHILD_SLOTS];
+    size_t          n;
+    size_t          next;    /* next unclaimed prefix (atomic) */
+} RankBuildJob;
+
+/* Count the canonical boards below each child of each claimed prefix */
+static void *rank_build_worker(void *arg) {
+    RankBuildJob *job = (RankBuildJob *)arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->n) break;
+
+        uint8_t prefix[RANK_PREFIX_DEPTH + 1];
+        for (int d = 0; d < RANK_PREFIX_DEPTH; d++)
+            prefix[d] = (uint8_t)((job->keys[i] >> (60 - 4 * d)) & 0xF);
+        uint16_t used = 0;
+        for (int d = 0; d < RANK_PREFIX_DEPTH; d++) used |= (uint16_t)(1u << prefix[d]);
+
+        for (int j = 0; j < RANK_CHILD_SLOTS; j++) {
+            prefix[RANK_PREFIX_DEPTH] = (uint8_t)nth_free_tile(used, j);
+            Enumerator e;
+            enum_init(&e);
+            EnumNode node;
+            if (enum_seed(&e, prefix, RANK_PREFIX_DEPTH + 1, &node))
+                enum_rec(&e, &node, 0);
+            job->child_count[i][j] = (uint32_t)e.count;
+        }
+    }
+    return NULL;
+}
+
+
+/*
+ * rank_table_build_c - Enumerate every canonical board once and write the
+ * rank table to `path`.
+ *
+ * nthreads <= 0 means one thread per CPU. Returns the number of classes,
+ * or 0 on failure (allocation or I/O).
+ */
+uint64_t rank_table_build_c(const char *path, int nthreads) {
+    /* Pass 1: every viable prefix, in order */
+    Enumerator e;
+    enum_init(&e);
+    e.leaf_depth = RANK_PREFIX_DEPTH;
+    EnumNode root = enum_root();
+    enum_rec(&e, &root, 0);
+    size_t n = e.count;
+
+    uint64_t *keys = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint32_t (*child_count)[RANK_CHILD_SLOTS] = malloc(n * sizeof(*child_count));
+    uint32_t *before = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint16_t (*child_before)[RANK_CHILD_SLOTS] = malloc(n * sizeof(*child_before));
+    uint64_t total = 0;
+    if (!keys || !child_count || !before || !child_before) goto done;
+
+    enum_init(&e);
+    e.leaf_depth = RANK_PREFIX_DEPTH;
+    e.prefixes = keys;
+    enum_rec(&e, &root, 0);
+
+    /* Pass 2: count below each child, spread over threads */
+    if (nthreads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (nthreads > BATCH_MAX_THREADS) nthreads = BATCH_MAX_THREADS;
+    RankBuildJob job = { keys, child_count, n, 0 };
+    pthread_t threads[BATCH_MAX_THREADS];
+    int started = 0;
+    while (started < nthreads - 1 &&
+           pthread_create(&threads[started], NULL, rank_build_worker, &job) == 0)
+        started++;
+    rank_build_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+
+    for (size_t i = 0; i < n; i++) {
+        before[i] = (uint32_t)total;
+        uint32_t local = 0;
+        for (int j = 0; j < RANK_CHILD_SLOTS; j++) {
+            child_before[i][j] = (uint16_t)local;
+            local += child_count[i][j];
+        }
+        total += local;
+    }
+
+    RankTableHeader header;
+    memcpy(header.magic, RANK_MAGIC, 8);
+    header.prefix_depth = RANK_PREFIX_DEPTH;
+    header.child_slots  = RANK_CHILD_SLOTS;
+    header.n_prefixes   = n;
+    header.n_classes    = total;
+
+    FILE *f = fopen(path, "wb");
+    if (!f ||
+        fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(keys, sizeof(uint64_t), n, f) != n ||
+        fwrite(before, sizeof(uint32_t), n, f) != n ||
+        fwrite(child_before, sizeof(*child_before), n, f) != n) {
+        total = 0;
+    }
+    if (f && fclose(f) != 0) total = 0;
+
+done:
+    free(keys);
+    free(child_count);
+    free(before);
+    free(child_before);
+    return total;
+}
+
+
+/*
+ * rank_table_load_c - Map a rank table written by rank_table_build_c.
+ * Returns the number of classes, or 0 if the file is missing or invalid.
+ */
+uint64_t rank_table_load_c(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RankTableHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t bytes = (size_t)st.st_size;
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const RankTableHeader *h = (const RankTableHeader *)map;
+    size_t n = (size_t)h->n_prefixes;
+    size_t expect = sizeof(*h) + n * (sizeof(uint64_t) + sizeof(uint32_t) +
+                                      RANK_CHILD_SLOTS * sizeof(uint16_t));
+    if (memcmp(h->magic, RANK_MAGIC, 8) != 0 ||
+        h->prefix_depth != RANK_PREFIX_DEPTH || h->child_slots != RANK_CHILD_SLOTS ||
+        bytes != expect) {
+        munmap(map, bytes);
+        return 0;
+    }
+
+    if (rank_table.header)
+        munmap((void *)rank_table.header, rank_table.map_bytes);
+    const char *base = (const char *)map + sizeof(*h);
+    rank_table.header       = h;
+    rank_table.keys         = (const uint64_t *)base;
+    rank_table.before       = (const uint32_t *)(base + n * sizeof(uint64_t));
+    rank_table.child_before = (const uint16_t (*)[RANK_CHILD_SLOTS])
+                              (base + n * (sizeof(uint64_t) + sizeof(uint32_t)));
+    rank_table.map_bytes    = bytes;
+    return h->n_classes;
+}
+
+
+/* Dense rank of a canonical board (packed tiles), or -1 */
+static int64_t tiles_rank(const uint8_t *tiles) {
+    if (!rank_table.header) return -1;
+
+    /* Binary search the prefix */
+    uint64_t key = tiles_key(tiles, RANK_PREFIX_DEPTH);
+    size_t lo = 0, hi = (size_t)rank_table.header->n_prefixes;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (rank_table.keys[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == rank_table.header->n_prefixes || rank_table.keys[lo] != key) return -1;
+
+    uint16_t used = 0;
+    for (int d = 0; d < RANK_PREFIX_DEPTH; d++) used |= (uint16_t)(1u << tiles[d]);
+    int slot = __builtin_popcount(~used & ((1u << tiles[RANK_PREFIX_DEPTH]) - 1) & 0xFFFF);
+
+    /* Count boards before this one in its depth-10 subtree */
+    Enumerator e;
+    enum_init(&e);
+    e.stop_at = tiles;
+    EnumNode node;
+    if (!enum_seed(&e, tiles, RANK_PREFIX_DEPTH + 1, &node)) return -1;
+    enum_rec(&e, &node, 0);
+
+    return (int64_t)rank_table.before[lo] + rank_table.child_before[lo][slot] + (int64_t)e.count;
+}
+
+
+/*
+ * board_rank_c - Dense rank of a board's equivalence class, in
+ * [0, N_classes). The board need not be canonical.
+ * Returns -1 if no rank table is loaded.
+ */
+int64_t board_rank_c(const int8_t *plants, const int8_t *poems) {
+    if (!rank_table.header) return -1;
+
+    uint8_t tiles[16], canonical[16];
+    tiles_pack(plants, poems, tiles);
+    tiles_canonicalize(tiles, canonical);
+    return tiles_rank(canonical);
+}
+
+
+/*
+ * board_unrank_c - Canonical board of the class with dense rank `rank`.
+ * Returns 0 on success, -1 if the rank is out of range or no table is
+ * loaded.
+ */
+int board_unrank_c(int64_t rank, int8_t *plants, int8_t *poems) {
+    if (!rank_table.header || rank < 0 ||
+        (uint64_t)rank >= rank_table.header->n_classes)
+        return -1;
+
+    /* Last prefix with before <= rank */
+    size_t lo = 0, hi = (size_t)rank_table.header->n_prefixes;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (rank_table.before[mid] <= (uint64_t)rank) lo = mid;
+        else hi = mid;
+    }
+    uint32_t rem = (uint32_t)((uint64_t)rank - rank_table.before[lo]);
+    int slot = RANK_CHILD_SLOTS - 1;
+    while (rank_table.child_before[lo][slot] > rem) slot--;
+    rem -= rank_table.child_before[lo][slot];
+
+    uint8_t prefix[RANK_PREFIX_DEPTH + 1];
+    uint16_t used = 0;
+    for (int d = 0; d < RANK_PREFIX_DEPTH; d++) {
+        prefix[d] = (uint8_t)((rank_table.keys[lo] >> (60 - 4 * d)) & 0xF);
+        used |= (uint16_t)(1u << prefix[d]);
+    }
+    prefix[RANK_PREFIX_DEPTH] = (uint8_t)nth_free_tile(used, slot);
+
+    /* Walk to the rem-th board of that subtree; it is left in e.tiles */
+    Enumerator e;
+    enum_init(&e);
+    e.max = (size_t)rem + 1;
+    EnumNode node;
+    if (!enum_seed(&e, prefix, RANK_PREFIX_DEPTH + 1, &node)) return -1;
+    if (!enum_rec(&e, &node, 0)) return -1;
+    tiles_unpack(e.tiles, plants, poems);
+    return 0;
+}
+
+
+/* ================================================================
+ * Batch canonicalization
+ *
+ * Whole arrays of boards in one call, for callers that hold boards as a
+ * buffer (Python bytearray / numpy int8 (N, 16, 2)) rather than as tile
+ * lists. Boards here are laid out per cell, (plant, poem) pairs, 32 bytes
+ * per board. Perm indexes are lexicographic ranks among the 16!
+ * arrangements of the standard tiles ordered by (plant, poem), as
+ * utils.board_to_perm_index and the database use.
+ * ================================================================ */
+
+static const int64_t FACTORIALS[16] = {
+    1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800, 39916800,
+    479001600, 6227020800LL, 87178291200LL, 1307674368000LL,
+};
+
+/* Pack one per-cell board; returns 0 unless it holds each tile exactly once */
+static int tiles_pack_pairs(const int8_t *pairs, uint8_t *tiles) {
+    uint32_t seen = 0;
+    for (int i = 0; i < 16; i++) {
+        int8_t plant = pairs[2 * i], poem = pairs[2 * i + 1];
+        if ((plant & ~3) || (poem & ~3)) return 0;
+        tiles[i] = (uint8_t)((plant << 2) | poem);
+        seen |= 1u << tiles[i];
+    }
+    return seen == 0xFFFF;
+}
+
+/* Perm index of packed tiles (a permutation of 0..15) */
+static int64_t tiles_perm_index(const uint8_t *tiles) {
+    uint32_t avail = 0xFFFF;
+    int64_t index = 0;
+    for (int i = 0; i < 16; i++) {
+        index += __builtin_popcount(avail & ((1u << tiles[i]) - 1)) * FACTORIALS[15 - i];
+        avail &= ~(1u << tiles[i]);
+    }
+    return index;
+}
+
+
+/*
+ * canonicalize_boards_c - Canonicalize n boards.
+ *
+ * Args:
+ *   boards:       n * 16 (plant, poem) pairs
+ *   out:          canonical boards, same layout (may alias boards)
+ *   perm_indexes: perm index of each canonical board
+ *   ranks:        dense class rank, -1 without a rank table
+ *
+ * Any output may be NULL. A board that is not a permutation of the 16
+ * tiles is copied to out unchanged and gets -1 in both index arrays.
+ * Returns the number of valid boards.
+ */
+size_t canonicalize_boards_c(const int8_t *boards, size_t n, int8_t *out,
+                             int64_t *perm_indexes, int64_t *ranks) {
+    size_t valid = 0;
+    for (size_t b = 0; b < n; b++) {
+        const int8_t *in = boards + 32 * b;
+        uint8_t tiles[16], best[16];
+        if (!tiles_pack_pairs(in, tiles)) {
+            if (out && out != boards) memcpy(out + 32 * b, in, 32);
+            if (perm_indexes) perm_indexes[b] = -1;
+            if (ranks) ranks[b] = -1;
+            continue;
+        }
+        tiles_canonicalize(tiles, best);
+        if (out) {
+            for (int i = 0; i < 16; i++) {
+                out[32 * b + 2 * i]     = (int8_t)(best[i] >> 2);
+                out[32 * b + 2 * i + 1] = (int8_t)(best[i] & 3);
+            }
+        }
+        if (perm_indexes) perm_indexes[b] = tiles_perm_index(best);
+        if (ranks) ranks[b] = tiles_rank(best);
+        valid++;
+    }
+    return valid;
+}
+
+
+/*
+ * perm_boards_c - Boards with the given perm indexes, as n * 16 (plant,
+ * poem) pairs (the inverse of the perm index above). An index outside
+ * [0, 16!) gives a board of -1s. Returns the number of valid indexes.
+ */
+size_t perm_boards_c(const int64_t *perm_indexes, size_t n, int8_t *out) {
+    size_t valid = 0;
+    for (size_t b = 0; b < n; b++) {
+        int64_t index = perm_indexes[b];
+        int8_t *board = out + 32 * b;
+        if (index < 0 || index >= FACTORIALS[15] * 16) {
+            memset(board, -1, 32);
+            continue;
+        }
+        uint16_t used = 0;
+        for (int i = 0; i < 16; i++) {
+            int tile = nth_free_tile(used, (int)(index / FACTORIALS[15 - i]));
+            index %= FACTORIALS[15 - i];
+            used |= (uint16_t)(1u << tile);
+            board[2 * i]     = (int8_t)(tile >> 2);
+            board[2 * i + 1] = (int8_t)(tile & 3);
+        }
+        valid++;
+    }
+    return valid;
+}
+
+
+/* ================================================================
+ * Solved-board lookup
+ *
+ * Point queries against the opening book written by src/book.py: one
+ * record per solved board, fixed width and sorted by canonical board, so
+ * opening it is a single mmap (no index to build) and a query is one
+ * canonicalization plus a binary search of the mapped file. The record is
+ * mapped back through the transform that canonicalized the query, so the
+ * moves it returns are cells of the board that was asked about and the
+ * line outcomes (row/column, which diagonal) are the ones on that board.
+ *
+ * File layout: see src/book.py. Header fields are little-endian; each
+ * entry is the key, tiles_key(canonical, 16) stored big-endian, followed
+ * by a P2 shard record.
+ * ================================================================ */
+
+#define BOOK_MAGIC        "NIYABOOK"
+#define BOOK_VERSION      1
+#define BOOK_HEADER_BYTES 20
+#define BOOK_RECORD_BYTES 14
+#define BOOK_ENTRY_BYTES  (8 + BOOK_RECORD_BYTES)
+
+typedef struct {
+    const uint8_t *entries;
+    uint64_t        count;
+    void           *map;
+    size_t          map_bytes;
+} OpeningBook;
+
+static OpeningBook book;
+
+/*
+ * Outcome of a line on the queried board, given its outcome on the
+ * canonical board (cell i of which is the query's map[i]): rotations and
+ * transposes turn rows into columns, and some of them swap the diagonals.
+ */
+static int8_t outcome_from_canonical(const uint8_t *map, int8_t outcome) {
+    if (outcome > OUT_ANTI_DIAG) return outcome;
+    int p = 0;
+    while (WIN_PATTERNS[p].outcome != outcome) p++;
+    uint16_t back = 0;
+    for (int i = 0; i < 16; i++)
+        if (WIN_PATTERNS[p].mask >> i & 1) back |= (uint16_t)(1u << map[i]);
+    for (p = 0; WIN_PATTERNS[p].mask != back; p++)
+        ;
+    return WIN_PATTERNS[p].outcome;
+}
+
+/*
+ * book_open_c - Map an opening book. Returns the number of boards in it,
+ * or 0 if the file is missing or invalid (the previous book, if any, stays
+ * open).
+ */
+uint64_t book_open_c(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < BOOK_HEADER_BYTES) {
+        close(fd);
+        return 0;
+    }
+    size_t bytes = (size_t)st.st_size;
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const uint8_t *h = (const uint8_t *)map;
+    uint16_t version = (uint16_t)(h[8] | h[9] << 8);
+    uint16_t record  = (uint16_t)(h[10] | h[11] << 8);
+    uint32_t block, count;
+    memcpy(&block, h + 12, 4);
+    memcpy(&count, h + 16, 4);
+    size_t index_bytes = block ? ((size_t)count + block - 1) / block * 8 : 0;
+    if (memcmp(h, BOOK_MAGIC, 8) != 0 || version != BOOK_VERSION ||
+        record != BOOK_RECORD_BYTES || block == 0 || count == 0 ||
+        bytes != BOOK_HEADER_BYTES + index_bytes + (size_t)count * BOOK_ENTRY_BYTES) {
+        munmap(map, bytes);
+        return 0;
+    }
+    /* Queries jump around the whole file */
+    madvise(map, bytes, MADV_RANDOM);
+
+    if (book.map) munmap(book.map, book.map_bytes);
+    book.entries   = h + BOOK_HEADER_BYTES + index_bytes;
+    book.count     = count;
+    book.map       = map;
+    book.map_bytes = bytes;
+    return count;
+}
+
+/* Record of the canonical board `key`, or NULL if it is not in the book */
+static const uint8_t *book_find(uint64_t key) {
+    uint64_t lo = 0, hi = book.count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const uint8_t *entry = book.entries + mid * BOOK_ENTRY_BYTES;
+        uint64_t k = 0;
+        for (int i = 0; i < 8; i++) k = k << 8 | entry[i];
+        if (k == key) return entry + 8;
+        if (k < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+/*
+ * book_lookup_c - Stored results of `n` boards.
+ *
+ * Args:
+ *   boards: n * (plants[16], poems[16]), any member of each class
+ *   out[n]: the stored result, mapped onto that board: its value, and
+ *           the optimal moves, lines and depths of the canonical board's
+ *           tie-break (which need not be the ones solve_board_c picks on
+ *           this board); best_move is -1 if the board is not in the book
+ *           or is not a permutation of the 16 tiles, and the P2 fields are
+ *           as with skip_p2 if it was solved without them
+ *
+ * Returns the number of boards found (0 if no book is open).
+ */
+size_t book_lookup_c(const int8_t *boards, size_t n, SolveResult *out) {
+    size_t found = 0;
+    for (size_t b = 0; b < n; b++) {
+        SolveResult *r = &out[b];
+        memset(r, 0, sizeof(*r));
+        r->best_move = -1;
+        memset(r->p2_moves, -1, 12);
+
+        const int8_t *plants = boards + 32 * b, *poems = plants + 16;
+        uint32_t seen = 0;
+        for (int i = 0; i < 16; i++)
+            if (!((plants[i] | poems[i]) & ~3)) seen |= 1u << (plants[i] << 2 | poems[i]);
+        if (seen != 0xFFFF) continue;  /* tiles_normalize indexes by plant and poem */
+
+        uint8_t tiles[16], canon[16];
+        tiles_pack(plants, poems, tiles);
+        const uint8_t *map = TRANSFORM_MAPS[tiles_canonicalize(tiles, canon)];
+        const uint8_t *rec = book.count ? book_find(tiles_key(canon, 16)) : NULL;
+        if (!rec) continue;
+        found++;
+
+        /* u16 best_move:4 | outcome:3 | winner:2 | game_depth:5 | has_p2:1 */
+        unsigned word = rec[0] | rec[1] << 8;
+        static const int8_t WINNER_SCORE[3] = {P1_WINS, P1_LOSES, DRAW_SCORE};
+        r->best_move  = (int8_t)map[word & 0xF];
+        r->outcome    = outcome_from_canonical(map, (int8_t)(word >> 4 & 7));
+        r->score      = WINNER_SCORE[word >> 7 & 3];
+        r->game_depth = (int8_t)(word >> 9 & 0x1F);
+        if (!(word >> 14 & 1)) continue;
+
+        /* One byte per canonical opening: p2_best_move:4 | outcome:3 | is_p1_win:1 */
+        int8_t inv[16];
+        for (int i = 0; i < 16; i++) inv[map[i]] = (int8_t)i;
+        for (int oi = 0; oi < NUM_OPENINGS; oi++) {
+            int slot = 0;
+            while (OPENING_INDICES[slot] != inv[OPENING_INDICES[oi]]) slot++;
+            uint8_t byte = rec[2 + slot];
+            r->p2_moves[oi]    = (int8_t)map[byte & 0xF];
+            r->p2_outcomes[oi] = outcome_from_canonical(map, (int8_t)(byte >> 4 & 7));
+            r->p2_scores[oi]   = (int8_t)((byte >> 7) ? P1_WINS
+                                          : r->p2_outcomes[oi] == OUT_DRAW ? DRAW_SCORE : P1_LOSES);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,74 @@
+"""
+Rank the most expensive boards of a traced run (main.py --trace) and
+summarize where the search spent its nodes.
+
+Usage:
+    python trace_report.py trace.jsonl              # Top 20 boards by nodes, then the histograms
+    python trace_report.py trace.jsonl --by seconds --top 50
+"""
+
+import argparse
+import json
+
+
+def load(path: str) -> list[dict]:
+    with open(path) as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def pct(part: float, whole: float) -> str:
+    return f"{100 * part / whole:5.1f}%" if whole else "   --"
+
+
+def print_top(records: list[dict], key: str, top: int) -> None:
+    print(f"{'perm_index':>15} {'nodes':>11} {'ms':>8} {'P2 phase':>8} {'P2 late':>7}  "
+          f"{'winner':<6} {'outcome':<14} {'move':>4} {'depth':>5}")
+    for r in sorted(records, key=lambda r: r[key], reverse=True)[:top]:
+        print(f"{r['perm_index']:>15} {r['nodes']:>11,} {1000 * r['seconds']:>8.1f} "
+              f"{pct(r['phase2_nodes'], r['nodes']):>8} {pct(r['p2_late_nodes'], r['nodes']):>7}  "
+              f"{r['winner']:<6} {r['outcome']:<14} {r['best_move']:>4} {r['game_depth']:>5}")
+
+
+def print_histograms(records: list[dict]) -> None:
+    total = sum(r["nodes"] for r in records)
+    costs = sorted((r["nodes"] for r in records), reverse=True)
+    tail = costs[:max(1, len(costs) // 10)]
+    print(f"\n{len(records):,} boards, {total:,} nodes; the costliest 10% take {pct(sum(tail), total).strip()}")
+    fail = sum(r["p2_fail_nodes"] for r in records)
+    late = sum(r["p2_late_nodes"] for r in records)
+    print(f"Under P2 replies that did not cut off: {pct(fail, total).strip()} of nodes, "
+          f"{pct(late, total).strip()} before a later reply did")
+
+    print(f"\n{'depth':>5} {'nodes':>8} {'TT probes':>10} {'TT hits':>8}")
+    for d in range(17):
+        nodes = sum(r["depth_nodes"][d] for r in records)
+        probes = sum(r["depth_tt_probes"][d] for r in records)
+        hits = sum(r["depth_tt_hits"][d] for r in records)
+        if nodes:
+            print(f"{d:>5} {pct(nodes, total):>8} {probes:>10,} {pct(hits, probes):>8}")
+
+    moving = sum(sum(r["reply_nodes"]) for r in records)
+    print(f"\n{'replies':>7} {'nodes':>8}")
+    for k in range(17):
+        nodes = sum(r["reply_nodes"][k] for r in records)
+        if nodes:
+            print(f"{k:>7} {pct(nodes, moving):>8}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Rank boards from a main.py --trace file.")
+    parser.add_argument("path", help="Trace file written by main.py --trace.")
+    parser.add_argument("--top", type=int, default=20, help="Boards to list (default: 20).")
+    parser.add_argument("--by", choices=("nodes", "seconds"), default="nodes",
+                        help="Cost to rank by (default: nodes).")
+    args = parser.parse_args()
+
+    records = load(args.path)
+    if not records:
+        raise SystemExit(f"[!] No traces in {args.path}")
+    print_top(records, args.by, args.top)
+    print_histograms(records)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,8 @@
 // Web Worker for AI computation (prevents UI freezing)
 
 import { findBestMove, findRandomMove } from "./minimax";
+import { loadOpeningBook } from "./opening-book";
+import { loadWasmSolver } from "./wasm-solver";
 import type { GameState, Difficulty } from "../engine/types";
 
 export interface AIWorkerMessage {
@@ -19,19 +21,28 @@ const DEPTH_LIMITS: Record<Difficulty, number> = {
   hard: 0,    // Unlimited (full solve)
 };
 
-self.onmessage = (e: MessageEvent<AIWorkerMessage>) => {
+// The C solver compiled to WebAssembly; null if unavailable
+const wasmSolver = loadWasmSolver(`${import.meta.env.BASE_URL}solver_core.wasm`);
+
+// Solved first moves and replies for perfect play; null if unavailable
+const openingBook = loadOpeningBook(`${import.meta.env.BASE_URL}opening_book.bin`);
+
+self.onmessage = async (e: MessageEvent<AIWorkerMessage>) => {
   const { state, difficulty } = e.data;
 
   let move: number;
+  const book = difficulty === "hard" ? await openingBook : null;
+  const bookMove = book ? await book.lookup(state) : null;
 
   if (difficulty === "easy") {
     move = findRandomMove(state).move;
+  } else if (bookMove !== null) {
+    move = bookMove;
   } else {
-    const maxDepth =
-      difficulty === "medium"
-        ? state.moveHistory.length + DEPTH_LIMITS[difficulty]
-        : 0;
-    move = findBestMove(state, maxDepth).move;
+    const solver = await wasmSolver;
+    move = solver
+      ? solver.bestMove(state, DEPTH_LIMITS[difficulty])
+      : findBestMove(state, DEPTH_LIMITS[difficulty]).move;
   }
 
   self.postMessage({ move } satisfies AIWorkerResponse);
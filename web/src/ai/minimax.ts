@@ -1,7 +1,12 @@
-// Minimax solver with alpha-beta pruning (ported from Python solver)
+// Minimax solver with alpha-beta pruning (bitboard port of src/solver_core.c)
+//
+// Used when the WebAssembly build of the C solver is unavailable. The search
+// allocates nothing per node: positions are bitmasks, legal moves come from
+// precomputed per-board compatibility masks, and the transposition table
+// lives in typed arrays. Search order, endgame cut-over and the root
+// tie-break follow the C engine, so perfect play picks the same moves.
 
 import type { GameState } from "../engine/types";
-import type { WinMethod } from "../engine/types";
 import { WIN_MASKS, OPENING_INDICES } from "../engine/constants";
 
 interface AIResult {
@@ -12,115 +17,351 @@ interface AIResult {
 const P1_WINS = 1;
 const P1_LOSES = -1;
 const DRAW_SCORE = 0;
+const INF = 2;
+const NEG_INF = -2;
 
-function checkWinMask(mask: number): WinMethod | null {
-  for (const [wm, method] of WIN_MASKS) {
-    if ((mask & wm) === wm) return method;
+// Tiles placed before the TT-free endgame search takes over
+const ENDGAME_DEPTH = 7;
+
+let OPENING_MASK = 0;
+for (const i of OPENING_INDICES) OPENING_MASK |= 1 << i;
+
+// ---- Win tables ----
+// HAS_WIN[mask]: mask contains a winning pattern.
+// THREAT_CELLS[mask]: cells that would complete a pattern if added to mask.
+const HAS_WIN = new Uint8Array(1 << 16);
+const THREAT_CELLS = new Uint16Array(1 << 16);
+{
+  const patterns = Int32Array.from(WIN_MASKS, ([mask]) => mask);
+  for (let mask = 0; mask < 1 << 16; mask++) {
+    let threats = 0;
+    for (let i = 0; i < patterns.length; i++) {
+      const missing = patterns[i] & ~mask;
+      if (missing === 0) HAS_WIN[mask] = 1;
+      else if ((missing & (missing - 1)) === 0) threats |= missing;
+    }
+    THREAT_CELLS[mask] = threats;
   }
-  return null;
 }
 
-function getLegalMovesRaw(
-  board: GameState["board"],
-  takenMask: number,
-  lastMoveIdx: number | null
-): number[] {
-  const moves: number[] = [];
+function popcount(x: number): number {
+  x -= (x >>> 1) & 0x55555555;
+  x = (x & 0x33333333) + ((x >>> 2) & 0x33333333);
+  return (Math.imul((x + (x >>> 4)) & 0x0f0f0f0f, 0x01010101) >>> 24);
+}
+
+// Index of the lowest set bit
+function lowestCell(bits: number): number {
+  return 31 - Math.clz32(bits & -bits);
+}
+
+// ---- Compatibility masks ----
+// compat[i] = cells whose tile shares a plant or poem with cell i (including
+// i), so the legal replies to a move on cell i are compat[i] & ~taken.
+const compat = new Uint16Array(16);
+
+// ---- Transposition table ----
+// 4-slot buckets in typed arrays. An entry is the packed masks
+// (p1 | p2 << 16) in ttKeys and, in ttData, last move (bits 0-3), value code
+// (bits 4-6, 0 = empty slot) and best move (bits 7-10). Entries depend only
+// on the board's compat masks, so they carry over between the moves of a
+// game and are cleared when the board changes. A full bucket evicts the
+// entry with the most tiles placed (cheapest to recompute).
+const TT_BUCKET_BITS = 16;
+const TT_SLOTS = 4;
+const ttKeys = new Int32Array(TT_SLOTS << TT_BUCKET_BITS);
+const ttData = new Uint16Array(TT_SLOTS << TT_BUCKET_BITS);
+
+// Value codes: one per (lo, hi) score interval, as in the C engine
+// (loss, draw and win are TT_V_DRAW + score)
+const TT_V_DRAW = 2;
+const TT_V_DRAW_OR_WIN = 4;
+const TT_V_LOSS_OR_DRAW = 5;
+const CODE_LO = Int8Array.of(0, P1_LOSES, DRAW_SCORE, P1_WINS, DRAW_SCORE, P1_LOSES);
+const CODE_HI = Int8Array.of(0, P1_LOSES, DRAW_SCORE, P1_WINS, P1_WINS, DRAW_SCORE);
+
+function ttBucket(key: number, last: number): number {
+  return (Math.imul(key ^ (last << 28), 0x9e3779b1) >>> (32 - TT_BUCKET_BITS)) * TT_SLOTS;
+}
+
+// Slot holding the position, or -1
+function ttProbe(key: number, last: number): number {
+  const base = ttBucket(key, last);
+  for (let s = base; s < base + TT_SLOTS; s++) {
+    const data = ttData[s];
+    if (data === 0) return -1; // slots fill front to back
+    if (ttKeys[s] === key && (data & 15) === last) return s;
+  }
+  return -1;
+}
 
-  if (lastMoveIdx === null) {
-    for (const i of OPENING_INDICES) {
-      if (!(takenMask & (1 << i))) moves.push(i);
+function ttStore(key: number, last: number, lo: number, hi: number, bestMove: number): void {
+  const code =
+    lo === hi ? TT_V_DRAW + lo : lo === DRAW_SCORE ? TT_V_DRAW_OR_WIN : TT_V_LOSS_OR_DRAW;
+  const data = last | (code << 4) | (bestMove << 7);
+  const base = ttBucket(key, last);
+  let victim = base;
+  let victimDepth = -1;
+  for (let s = base; s < base + TT_SLOTS; s++) {
+    if (ttData[s] === 0 || (ttKeys[s] === key && (ttData[s] & 15) === last)) {
+      victim = s;
+      break;
+    }
+    const d = popcount(ttKeys[s]);
+    if (d > victimDepth) {
+      victim = s;
+      victimDepth = d;
     }
-    return moves;
   }
+  ttKeys[victim] = key;
+  ttData[victim] = data;
+}
 
-  const lastTile = board[lastMoveIdx];
+/** Load the board's compat masks; clear the TT if they changed. */
+function setBoard(board: GameState["board"]): void {
+  let changed = false;
   for (let i = 0; i < 16; i++) {
-    if (!(takenMask & (1 << i))) {
-      const tile = board[i];
-      if (tile.plant === lastTile.plant || tile.poem === lastTile.poem) {
-        moves.push(i);
-      }
+    let m = 0;
+    for (let j = 0; j < 16; j++) {
+      if (board[j].plant === board[i].plant || board[j].poem === board[i].poem) m |= 1 << j;
+    }
+    if (compat[i] !== m) changed = true;
+    compat[i] = m;
+  }
+  if (changed) ttData.fill(0);
+}
+
+// ---- Search ----
+
+/**
+ * A legal move that wins on the spot, completing one of the mover's
+ * patterns or (before the last ply) leaving the opponent no reply; -1 if none.
+ */
+function findImmediateWin(moves: number, taken: number, moverMask: number, nextDepth: number): number {
+  let winning = moves & THREAT_CELLS[moverMask];
+  if (nextDepth < 16) {
+    for (let rest = moves & ~winning; rest; rest &= rest - 1) {
+      const move = lowestCell(rest);
+      if ((compat[move] & ~(taken | (1 << move))) === 0) winning |= 1 << move;
+    }
+  }
+  return winning ? lowestCell(winning) : -1;
+}
+
+/**
+ * Fail-soft alpha-beta over the empty cells without the TT, for the last
+ * plies (these subtrees are cheaper to search than to look up).
+ */
+function endgame(
+  p1Mask: number, p2Mask: number, empty: number, lastMove: number,
+  isP1Turn: boolean, alpha: number, beta: number
+): number {
+  const moverWins = isP1Turn ? P1_WINS : P1_LOSES;
+  if (HAS_WIN[isP1Turn ? p2Mask : p1Mask]) return -moverWins;
+  if (empty === 0) return DRAW_SCORE;
+
+  const moves = compat[lastMove] & empty;
+  if (moves === 0) return -moverWins;
+  if (moves & THREAT_CELLS[isP1Turn ? p1Mask : p2Mask]) return moverWins;
+  if ((empty & (empty - 1)) === 0) return DRAW_SCORE;
+  for (let rest = moves; rest; rest &= rest - 1) {
+    const bit = rest & -rest;
+    if ((compat[lowestCell(bit)] & empty & ~bit) === 0) return moverWins;
+  }
+
+  let bestScore = isP1Turn ? NEG_INF : INF;
+  for (let rest = moves; rest; rest &= rest - 1) {
+    const bit = rest & -rest;
+    const move = lowestCell(bit);
+    if (isP1Turn) {
+      const s = endgame(p1Mask | bit, p2Mask, empty & ~bit, move, false, alpha, beta);
+      if (s > bestScore) bestScore = s;
+      if (s > alpha) alpha = s;
+    } else {
+      const s = endgame(p1Mask, p2Mask | bit, empty & ~bit, move, true, alpha, beta);
+      if (s < bestScore) bestScore = s;
+      if (s < beta) beta = s;
     }
+    if (beta <= alpha) break;
   }
-  return moves;
+  return bestScore;
 }
 
+/** Fail-soft alpha-beta returning the position's score from P1's view. */
 function minimax(
-  board: GameState["board"],
-  p1Mask: number,
-  p2Mask: number,
-  lastMoveIdx: number,
-  isP1Turn: boolean,
-  alpha: number,
-  beta: number,
-  depth: number,
-  maxDepth: number,
-  cache: Map<string, number>
+  p1Mask: number, p2Mask: number, lastMove: number, isP1Turn: boolean,
+  alpha: number, beta: number, depth: number
 ): number {
-  // Cache lookup
-  const key = `${p1Mask},${p2Mask},${lastMoveIdx},${isP1Turn ? 1 : 0}`;
-  const cached = cache.get(key);
-  if (cached !== undefined) return cached;
+  if (depth >= ENDGAME_DEPTH) {
+    return endgame(p1Mask, p2Mask, ~(p1Mask | p2Mask) & 0xffff, lastMove, isP1Turn, alpha, beta);
+  }
 
-  // Check if previous move won
+  // TT lookup: exact entries and cutting bounds return immediately,
+  // other bounds narrow the window
+  const key = p1Mask | (p2Mask << 16);
+  let knownLo = P1_LOSES;
+  let knownHi = P1_WINS;
+  let hint = -1;
+  const slot = ttProbe(key, lastMove);
+  if (slot >= 0) {
+    const data = ttData[slot];
+    const lo = CODE_LO[(data >> 4) & 7];
+    const hi = CODE_HI[(data >> 4) & 7];
+    if (lo === hi || lo >= beta) return lo;
+    if (hi <= alpha) return hi;
+    knownLo = lo;
+    knownHi = hi;
+    hint = data >> 7;
+    if (lo > alpha) alpha = lo;
+    if (hi < beta) beta = hi;
+  }
+
+  // Previous move won
   const prevMask = isP1Turn ? p2Mask : p1Mask;
-  if (checkWinMask(prevMask) !== null) {
+  if (HAS_WIN[prevMask]) {
     const score = isP1Turn ? P1_LOSES : P1_WINS;
-    cache.set(key, score);
+    ttStore(key, lastMove, score, score, 0);
     return score;
   }
 
   // Full board = draw
   if (depth === 16) {
-    cache.set(key, DRAW_SCORE);
-    return DRAW_SCORE;
-  }
-
-  // Depth limit for medium difficulty
-  if (maxDepth > 0 && depth >= maxDepth) {
-    cache.set(key, DRAW_SCORE);
+    ttStore(key, lastMove, DRAW_SCORE, DRAW_SCORE, 0);
     return DRAW_SCORE;
   }
 
-  // Legal moves
-  const takenMask = p1Mask | p2Mask;
-  const moves = getLegalMovesRaw(board, takenMask, lastMoveIdx);
-
   // Blockade
-  if (moves.length === 0) {
+  const taken = p1Mask | p2Mask;
+  const moves = compat[lastMove] & ~taken;
+  if (moves === 0) {
     const score = isP1Turn ? P1_LOSES : P1_WINS;
-    cache.set(key, score);
+    ttStore(key, lastMove, score, score, 0);
     return score;
   }
 
-  let bestScore: number;
+  // Immediate win: no need to search any child
+  const nextDepth = depth + 1;
+  const winMove = findImmediateWin(moves, taken, isP1Turn ? p1Mask : p2Mask, nextDepth);
+  if (winMove >= 0) {
+    const score = isP1Turn ? P1_WINS : P1_LOSES;
+    ttStore(key, lastMove, score, score, winMove);
+    return score;
+  }
 
-  if (isP1Turn) {
-    bestScore = -Infinity;
-    for (const move of moves) {
-      const score = minimax(
-        board, p1Mask | (1 << move), p2Mask, move, false,
-        alpha, beta, depth + 1, maxDepth, cache
-      );
-      bestScore = Math.max(bestScore, score);
-      alpha = Math.max(alpha, score);
-      if (beta <= alpha) break;
+  // Move classes, searched in order: the TT's best move, moves onto a cell
+  // the opponent needs, quiet moves, moves that hand the opponent a pattern
+  const threats = THREAT_CELLS[prevMask] & ~taken;
+  let losing = 0;
+  if (threats) {
+    for (let rest = moves; rest; rest &= rest - 1) {
+      const bit = rest & -rest;
+      if (compat[lowestCell(bit)] & ~(taken | bit) & threats) losing |= bit;
     }
-  } else {
-    bestScore = Infinity;
-    for (const move of moves) {
-      const score = minimax(
-        board, p1Mask, p2Mask | (1 << move), move, true,
-        alpha, beta, depth + 1, maxDepth, cache
-      );
-      bestScore = Math.min(bestScore, score);
-      beta = Math.min(beta, score);
+  }
+  const first = hint >= 0 ? moves & (1 << hint) : 0;
+  const others = moves & ~first;
+  const blocks = others & threats & ~losing;
+  const quiet = others & ~threats & ~losing;
+  losing &= others;
+
+  let bestMove = hint >= 0 ? hint : lowestCell(moves);
+  const alpha0 = alpha;
+  const beta0 = beta;
+  let bestScore = isP1Turn ? NEG_INF : INF;
+
+  for (let c = 0; c < 4 && alpha < beta; c++) {
+    let rest = c === 0 ? first : c === 1 ? blocks : c === 2 ? quiet : losing;
+    for (; rest; rest &= rest - 1) {
+      const bit = rest & -rest;
+      const move = lowestCell(bit);
+      if (isP1Turn) {
+        const s = minimax(p1Mask | bit, p2Mask, move, false, alpha, beta, nextDepth);
+        if (s > bestScore) {
+          bestScore = s;
+          bestMove = move;
+        }
+        if (s > alpha) alpha = s;
+      } else {
+        const s = minimax(p1Mask, p2Mask | bit, move, true, alpha, beta, nextDepth);
+        if (s < bestScore) {
+          bestScore = s;
+          bestMove = move;
+        }
+        if (s < beta) beta = s;
+      }
       if (beta <= alpha) break;
     }
   }
 
-  cache.set(key, bestScore);
+  // Fail-low gives an upper bound, fail-high a lower bound
+  let lo = knownLo;
+  let hi = knownHi;
+  if (bestScore <= alpha0) hi = bestScore;
+  else if (bestScore >= beta0) lo = bestScore;
+  else lo = hi = bestScore;
+  if (lo !== P1_LOSES || hi !== P1_WINS) ttStore(key, lastMove, lo, hi, bestMove);
+  return bestScore;
+}
+
+// ---- Root driver ----
+// Scores are ternary, so the root only asks zero-window questions
+// "is the value >= target?", and ties go to the lowest cell index.
+
+function valueAtLeast(
+  p1Mask: number, p2Mask: number, lastMove: number, isP1Turn: boolean,
+  target: number, depth: number
+): boolean {
+  return minimax(p1Mask, p2Mask, lastMove, isP1Turn, target - 1, target, depth) >= target;
+}
+
+function exactValue(p1Mask: number, p2Mask: number, lastMove: number, isP1Turn: boolean, depth: number): number {
+  if (valueAtLeast(p1Mask, p2Mask, lastMove, isP1Turn, P1_WINS, depth)) return P1_WINS;
+  if (valueAtLeast(p1Mask, p2Mask, lastMove, isP1Turn, DRAW_SCORE, depth)) return DRAW_SCORE;
+  return P1_LOSES;
+}
+
+/** Lowest-index move whose child keeps the position's known value. */
+function firstOptimalMove(
+  p1Mask: number, p2Mask: number, moves: number, isP1Turn: boolean,
+  value: number, nextDepth: number
+): number {
+  if (value === (isP1Turn ? P1_LOSES : P1_WINS)) return lowestCell(moves);
+  for (let rest = moves; rest; rest &= rest - 1) {
+    const bit = rest & -rest;
+    const move = lowestCell(bit);
+    const keeps = isP1Turn
+      ? valueAtLeast(p1Mask | bit, p2Mask, move, false, value, nextDepth)
+      : !valueAtLeast(p1Mask, p2Mask | bit, move, true, value + 1, nextDepth);
+    if (keeps) return move;
+  }
+  return lowestCell(moves);
+}
+
+/** Depth-limited alpha-beta scoring the horizon as a draw (no TT). */
+function horizonValue(
+  p1Mask: number, p2Mask: number, lastMove: number, isP1Turn: boolean,
+  alpha: number, beta: number, plies: number
+): number {
+  if (HAS_WIN[isP1Turn ? p2Mask : p1Mask]) return isP1Turn ? P1_LOSES : P1_WINS;
+  const taken = p1Mask | p2Mask;
+  if (taken === 0xffff || plies === 0) return DRAW_SCORE;
+  const moves = compat[lastMove] & ~taken;
+  if (moves === 0) return isP1Turn ? P1_LOSES : P1_WINS;
+
+  let bestScore = isP1Turn ? NEG_INF : INF;
+  for (let rest = moves; rest && alpha < beta; rest &= rest - 1) {
+    const bit = rest & -rest;
+    const move = lowestCell(bit);
+    if (isP1Turn) {
+      const s = horizonValue(p1Mask | bit, p2Mask, move, false, alpha, beta, plies - 1);
+      if (s > bestScore) bestScore = s;
+      if (s > alpha) alpha = s;
+    } else {
+      const s = horizonValue(p1Mask, p2Mask | bit, move, true, alpha, beta, plies - 1);
+      if (s < bestScore) bestScore = s;
+      if (s < beta) beta = s;
+    }
+  }
   return bestScore;
 }
 
@@ -128,42 +369,69 @@ function minimax(
  * Find the best move for the current player.
  *
  * @param state Current game state
- * @param maxDepth 0 = unlimited (hard), >0 = depth-limited (medium)
+ * @param maxPlies 0 = perfect play (hard), >0 = look that many plies ahead (medium)
  */
-export function findBestMove(state: GameState, maxDepth: number = 0): AIResult {
-  const cache = new Map<string, number>();
+export function findBestMove(state: GameState, maxPlies: number = 0): AIResult {
+  setBoard(state.board);
   const isP1 = state.currentPlayer === "p1";
-  const takenMask = state.p1Mask | state.p2Mask;
-  const moves = getLegalMovesRaw(state.board, takenMask, state.lastMoveIndex);
-
-  let bestMove = moves[0];
-  let bestScore = isP1 ? -Infinity : Infinity;
+  const p1Mask = state.p1Mask;
+  const p2Mask = state.p2Mask;
+  const taken = p1Mask | p2Mask;
+  const lastMove = state.lastMoveIndex ?? -1;
+  const moves = lastMove < 0 ? OPENING_MASK & ~taken : compat[lastMove] & ~taken;
+  if (moves === 0) return { move: -1, score: isP1 ? P1_LOSES : P1_WINS };
 
-  for (const move of moves) {
-    const newP1 = isP1 ? state.p1Mask | (1 << move) : state.p1Mask;
-    const newP2 = isP1 ? state.p2Mask : state.p2Mask | (1 << move);
-    const depth = state.moveHistory.length + 1;
-
-    const score = minimax(
-      state.board, newP1, newP2, move, !isP1,
-      -Infinity, Infinity, depth, maxDepth, cache
-    );
+  if (maxPlies > 0) {
+    let bestMove = lowestCell(moves);
+    let alpha = NEG_INF;
+    let beta = INF;
+    for (let rest = moves; rest && alpha < beta; rest &= rest - 1) {
+      const bit = rest & -rest;
+      const move = lowestCell(bit);
+      if (isP1) {
+        const s = horizonValue(p1Mask | bit, p2Mask, move, false, alpha, beta, maxPlies - 1);
+        if (s > alpha) {
+          alpha = s;
+          bestMove = move;
+        }
+      } else {
+        const s = horizonValue(p1Mask, p2Mask | bit, move, true, alpha, beta, maxPlies - 1);
+        if (s < beta) {
+          beta = s;
+          bestMove = move;
+        }
+      }
+    }
+    return { move: bestMove, score: isP1 ? alpha : beta };
+  }
 
-    if (isP1 ? score > bestScore : score < bestScore) {
-      bestScore = score;
-      bestMove = move;
+  // Opening: the first move that can force a win, else the first that can
+  // force a draw
+  if (lastMove < 0) {
+    for (const target of [P1_WINS, DRAW_SCORE]) {
+      for (let rest = moves; rest; rest &= rest - 1) {
+        const move = lowestCell(rest);
+        if (valueAtLeast(1 << move, 0, move, false, target, 1)) return { move, score: target };
+      }
     }
+    return { move: lowestCell(moves), score: P1_LOSES };
   }
 
-  return { move: bestMove, score: bestScore };
+  const depth = popcount(taken);
+  const value = exactValue(p1Mask, p2Mask, lastMove, isP1, depth);
+  return { move: firstOptimalMove(p1Mask, p2Mask, moves, isP1, value, depth + 1), score: value };
 }
 
 /**
  * Pick a random legal move (for easy difficulty).
  */
 export function findRandomMove(state: GameState): AIResult {
-  const takenMask = state.p1Mask | state.p2Mask;
-  const moves = getLegalMovesRaw(state.board, takenMask, state.lastMoveIndex);
-  const move = moves[Math.floor(Math.random() * moves.length)];
-  return { move, score: 0 };
+  setBoard(state.board);
+  const taken = state.p1Mask | state.p2Mask;
+  const lastMove = state.lastMoveIndex ?? -1;
+  let moves = lastMove < 0 ? OPENING_MASK & ~taken : compat[lastMove] & ~taken;
+  for (let skip = Math.floor(Math.random() * popcount(moves)); skip > 0; skip--) {
+    moves &= moves - 1;
+  }
+  return { move: lowestCell(moves), score: 0 };
 }
@@ -0,0 +1,139 @@
+// Opening book exported from the solved database (src/book.py)
+//
+// `python src/book.py` writes public/opening_book.bin: for every solved
+// board, the best first move and the best reply to each opening. The hard
+// AI plays those instantly instead of searching the two most expensive
+// positions of the game. The file is sorted by canonical board; only its
+// header and block index are fetched up front, then one range request per
+// block that is actually looked up.
+
+import { OPENING_INDICES } from "../engine/constants";
+import { canonicalize } from "../engine/symmetry";
+import type { GameState } from "../engine/types";
+
+const MAGIC = "NIYABOOK";
+const VERSION = 1;
+const HEADER_BYTES = 20;
+const KEY_BYTES = 8;
+
+// Shard record (src/shards.py): u16 best_move:4 | outcome:3 | winner:2 |
+// game_depth:5 | has_p2:1, then one byte per opening in OPENING_INDICES
+// order with the reply in its low 4 bits
+const HAS_P2_BIT = 1 << 14;
+const OPENING_SLOT: ReadonlyMap<number, number> = new Map(
+  [...OPENING_INDICES].map((cell, slot) => [cell, slot])
+);
+
+export interface OpeningBook {
+  /**
+   * Book move for the side to move, or null if the position is past the
+   * opening or the board is not in the book.
+   */
+  lookup(state: GameState): Promise<number | null>;
+}
+
+/** Bytes [start, end) of the file; servers that ignore Range send all of it. */
+async function fetchRange(url: string, start: number, end: number): Promise<Uint8Array> {
+  const response = await fetch(url, { headers: { Range: `bytes=${start}-${end - 1}` } });
+  if (!response.ok) throw new Error(`${url}: HTTP ${response.status}`);
+  const bytes = new Uint8Array(await response.arrayBuffer());
+  return response.status === 206 ? bytes : bytes.subarray(start, end);
+}
+
+/** Compare two 8-byte keys in file order. */
+function compareKeys(a: Uint8Array, b: Uint8Array): number {
+  for (let i = 0; i < KEY_BYTES; i++) {
+    if (a[i] !== b[i]) return a[i] - b[i];
+  }
+  return 0;
+}
+
+/** Pack a canonical board into its book key. */
+function boardKey(cells: Uint8Array): Uint8Array {
+  const key = new Uint8Array(KEY_BYTES);
+  for (let i = 0; i < KEY_BYTES; i++) key[i] = (cells[2 * i] << 4) | cells[2 * i + 1];
+  return key;
+}
+
+/**
+ * Fetch the book's header and block index. Resolves to null when the file
+ * is missing or not a book (e.g. the dev server's index.html fallback).
+ */
+export async function loadOpeningBook(url: string): Promise<OpeningBook | null> {
+  try {
+    const header = await fetchRange(url, 0, HEADER_BYTES);
+    const view = new DataView(header.buffer, header.byteOffset, header.byteLength);
+    const magic = String.fromCharCode(...header.subarray(0, 8));
+    if (magic !== MAGIC || view.getUint16(8, true) !== VERSION) return null;
+    const recordSize = view.getUint16(10, true);
+    const blockSize = view.getUint32(12, true);
+    const count = view.getUint32(16, true);
+    if (count === 0) return null;
+    const nBlocks = Math.ceil(count / blockSize);
+    const entryBytes = KEY_BYTES + recordSize;
+    const entriesStart = HEADER_BYTES + nBlocks * KEY_BYTES;
+
+    const index = await fetchRange(url, HEADER_BYTES, entriesStart);
+    const blocks = new Map<number, Promise<Uint8Array>>();
+
+    /** Record bytes for a canonical board, or null if it is not in the book. */
+    async function findRecord(key: Uint8Array): Promise<Uint8Array | null> {
+      // Last block whose first key is <= key
+      let lo = 0;
+      let hi = nBlocks;
+      while (hi - lo > 1) {
+        const mid = (lo + hi) >> 1;
+        const first = index.subarray(mid * KEY_BYTES, (mid + 1) * KEY_BYTES);
+        if (compareKeys(first, key) <= 0) lo = mid;
+        else hi = mid;
+      }
+
+      const b = lo;
+      let block = blocks.get(b);
+      if (!block) {
+        const start = entriesStart + b * blockSize * entryBytes;
+        const n = Math.min(blockSize, count - b * blockSize);
+        block = fetchRange(url, start, start + n * entryBytes);
+        blocks.set(b, block);
+        block.catch(() => blocks.delete(b)); // retry on the next lookup
+      }
+      const entries = await block;
+
+      lo = 0;
+      hi = entries.length / entryBytes;
+      while (lo < hi) {
+        const mid = (lo + hi) >> 1;
+        const entry = entries.subarray(mid * entryBytes, (mid + 1) * entryBytes);
+        const order = compareKeys(entry, key);
+        if (order === 0) return entry.subarray(KEY_BYTES);
+        if (order < 0) lo = mid + 1;
+        else hi = mid;
+      }
+      return null;
+    }
+
+    return {
+      async lookup(state: GameState): Promise<number | null> {
+        const ply = state.moveHistory.length;
+        if (ply > 1 || state.isGameOver) return null;
+
+        const { cells, map } = canonicalize(state.board);
+        let record: Uint8Array | null;
+        try {
+          record = await findRecord(boardKey(cells));
+        } catch {
+          return null;
+        }
+        if (!record) return null;
+
+        // Book moves are cells of the canonical board: map them back
+        if (ply === 0) return map[record[0] & 0xf];
+        if (!(((record[1] << 8) | record[0]) & HAS_P2_BIT)) return null;
+        const slot = OPENING_SLOT.get(map.indexOf(state.lastMoveIndex!));
+        return slot === undefined ? null : map[record[2 + slot] & 0xf];
+      },
+    };
+  } catch {
+    return null;
+  }
+}
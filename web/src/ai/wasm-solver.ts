@@ -0,0 +1,88 @@
+// WebAssembly build of the backend C solver (src/solver_core.c)
+//
+// `npm run build:wasm` compiles it to public/solver_core.wasm. Perfect play
+// uses the same search and tie-break as the backend, so the AI's moves match
+// the solved database. If the file is missing or fails to load, callers fall
+// back to the TypeScript minimax.
+
+import type { GameState } from "../engine/types";
+
+// Transposition table in linear memory: allocated on the first solve and
+// reused for every later one (a generation bump, not a clear)
+const TT_BYTES = 4 << 20;
+
+// Returned by the stubbed imports (WASI "function not implemented")
+const ENOSYS = 52;
+
+interface SolverExports {
+  memory: WebAssembly.Memory;
+  _initialize?: () => void;
+  malloc: (size: number) => number;
+  tt_configure_c: (bytes: number) => number;
+  best_move_c: (
+    plants: number,
+    poems: number,
+    p1Mask: number,
+    p2Mask: number,
+    lastMove: number,
+    maxPlies: number
+  ) => number;
+}
+
+export interface WasmSolver {
+  /**
+   * Move for the side to move, or -1 if the game is over.
+   *
+   * @param maxPlies 0 = perfect play, >0 = look that many plies ahead
+   */
+  bestMove(state: GameState, maxPlies: number): number;
+}
+
+/**
+ * Stub out every imported function. Only the rank-table file I/O in the C
+ * library reaches libc's host imports; best_move_c never does.
+ */
+function stubImports(module: WebAssembly.Module): WebAssembly.Imports {
+  const imports: Record<string, Record<string, () => number>> = {};
+  for (const { module: name, name: field, kind } of WebAssembly.Module.imports(module)) {
+    if (kind === "function") {
+      (imports[name] ??= {})[field] = () => ENOSYS;
+    }
+  }
+  return imports;
+}
+
+/**
+ * Fetch and instantiate the solver. Resolves to null when WebAssembly or
+ * the .wasm file is unavailable.
+ */
+export async function loadWasmSolver(url: string): Promise<WasmSolver | null> {
+  try {
+    const response = await fetch(url);
+    if (!response.ok) return null;
+    const module = await WebAssembly.compile(await response.arrayBuffer());
+    const instance = await WebAssembly.instantiate(module, stubImports(module));
+    const exports = instance.exports as unknown as SolverExports;
+
+    exports._initialize?.(); // runs the C constructors (win tables)
+    exports.tt_configure_c(TT_BYTES);
+    const boardPtr = exports.malloc(32); // plants[16], poems[16]
+
+    return {
+      bestMove(state: GameState, maxPlies: number): number {
+        // A fresh view each call: memory growth replaces the buffer
+        const cells = new Int8Array(exports.memory.buffer, boardPtr, 32);
+        state.board.forEach((tile, i) => {
+          cells[i] = tile.plant;
+          cells[16 + i] = tile.poem;
+        });
+        return exports.best_move_c(
+          boardPtr, boardPtr + 16, state.p1Mask, state.p2Mask,
+          state.lastMoveIndex ?? -1, maxPlies
+        );
+      },
+    };
+  } catch {
+    return null;
+  }
+}
@@ -0,0 +1,71 @@
+// Board canonicalization (same equivalences as the Python solver's
+// canonicalize_board): 8 spatial symmetries, plant/poem relabeling and the
+// plant↔poem swap. Boards in one class have the same solved result.
+
+import type { Tile } from "./types";
+
+/**
+ * The 8 rotations/reflections of the 4×4 grid, in the order of Python's
+ * TRANSFORM_MAPS: the transformed board's cell i is the original's map[i].
+ */
+export const TRANSFORM_MAPS: readonly (readonly number[])[] = (() => {
+  const at = (f: (r: number, c: number) => number) =>
+    Array.from({ length: 16 }, (_, i) => f(i >> 2, i & 3));
+  return [
+    at((r, c) => r * 4 + c),             // identity
+    at((r, c) => (3 - c) * 4 + r),       // rotate 90°
+    at((r, c) => (3 - r) * 4 + (3 - c)), // rotate 180°
+    at((r, c) => c * 4 + (3 - r)),       // rotate 270°
+    at((r, c) => (3 - r) * 4 + c),       // horizontal reflection
+    at((r, c) => r * 4 + (3 - c)),       // vertical reflection
+    at((r, c) => c * 4 + r),             // transpose
+    at((r, c) => (3 - c) * 4 + (3 - r)), // anti-transpose
+  ];
+})();
+
+export interface Canonical {
+  /** Canonical board, 16 nibbles (plant << 2 | poem), cell 0 first */
+  cells: Uint8Array;
+  /** Spatial map into the original board: canonical cell i is map[i] */
+  map: readonly number[];
+}
+
+/**
+ * Smallest board in the class, and the transform that produced it. For
+ * each spatial map and swap the smallest relabeling numbers labels in
+ * order of first appearance, so only 16 candidates are built.
+ */
+export function canonicalize(board: Tile[]): Canonical {
+  let best: Uint8Array | null = null;
+  let bestMap = TRANSFORM_MAPS[0];
+  const cells = new Uint8Array(16);
+
+  for (const map of TRANSFORM_MAPS) {
+    for (const swap of [false, true]) {
+      const plantLabel = [-1, -1, -1, -1];
+      const poemLabel = [-1, -1, -1, -1];
+      let nPlants = 0;
+      let nPoems = 0;
+      // Compare as we build; stop as soon as the candidate is larger
+      let order = best === null ? -1 : 0;
+      for (let i = 0; i < 16; i++) {
+        const tile = board[map[i]];
+        const a = swap ? tile.poem : tile.plant;
+        const b = swap ? tile.plant : tile.poem;
+        if (plantLabel[a] < 0) plantLabel[a] = nPlants++;
+        if (poemLabel[b] < 0) poemLabel[b] = nPoems++;
+        cells[i] = (plantLabel[a] << 2) | poemLabel[b];
+        if (order === 0 && cells[i] !== best![i]) {
+          order = cells[i] < best![i] ? -1 : 1;
+          if (order > 0) break;
+        }
+      }
+      if (order < 0) {
+        best = cells.slice();
+        bestMap = map;
+      }
+    }
+  }
+
+  return { cells: best!, map: bestMap };
+}